@@ -0,0 +1,199 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <string.h>
+
+#include "decompress.hpp"
+
+/* size of the output blocks */
+#define OUT_BLOCK (1024*1024)
+
+compression detect_compression(const void *p, size_t len)
+{
+  const unsigned char *s = reinterpret_cast<const unsigned char *>(p);
+
+  if (len >= 2 && s[0] == 0x1f && s[1] == 0x8b) {
+    return COMPRESSION_GZIP;
+  }
+  if (len >= 4 && s[0] == 0x28 && s[1] == 0xb5 && s[2] == 0x2f && s[3] == 0xfd) {
+    return COMPRESSION_ZSTD;
+  }
+  return COMPRESSION_NONE;
+}
+
+decompressor::decompressor(compression type)
+ : type_(type),
+   out_(OUT_BLOCK),
+   ended_(false)
+{
+  memset(&zs_, 0, sizeof(zs_));
+#ifdef HAVE_ZSTD
+  zds_ = NULL;
+#endif
+
+  if (type_ == COMPRESSION_GZIP) {
+    /* 32: detect the gzip or zlib header */
+    if (inflateInit2(&zs_, 15 + 32) != Z_OK) {
+      error_ = "inflateInit2() failed";
+    }
+  } else if (type_ == COMPRESSION_ZSTD) {
+#ifdef HAVE_ZSTD
+    if ((zds_ = ZSTD_createDStream()) == NULL || ZSTD_isError(ZSTD_initDStream(zds_))) {
+      error_ = "ZSTD_initDStream() failed";
+    }
+#else
+    error_ = "zstd compressed input is not supported by this build";
+#endif
+  }
+}
+
+decompressor::~decompressor()
+{
+  if (type_ == COMPRESSION_GZIP) {
+    inflateEnd(&zs_);
+  }
+#ifdef HAVE_ZSTD
+  if (zds_) {
+    ZSTD_freeDStream(zds_);
+  }
+#endif
+}
+
+bool decompressor::write(const char *in, size_t len, output_cb cb, void *v)
+{
+  if (!error_.empty()) {
+    return false;
+  }
+
+  if (type_ == COMPRESSION_GZIP) {
+    /* avail_in is 32 bits wide */
+    while (len > 0) {
+      uInt n = (len > 0x40000000) ? 0x40000000 : len;
+
+      zs_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+      zs_.avail_in = n;
+      in += n;
+      len -= n;
+
+      while (zs_.avail_in > 0) {
+        size_t out;
+        int rv;
+
+        /* the next member of a concatenated file */
+        if (ended_) {
+          inflateReset(&zs_);
+          ended_ = false;
+        }
+
+        zs_.next_out = reinterpret_cast<Bytef *>(out_.data());
+        zs_.avail_out = out_.size();
+        rv = inflate(&zs_, Z_NO_FLUSH);
+
+        if (rv != Z_OK && rv != Z_STREAM_END && rv != Z_BUF_ERROR) {
+          error_ = zs_.msg ? zs_.msg : "invalid gzip data";
+          return false;
+        }
+
+        if ((out = out_.size() - zs_.avail_out) > 0 && !cb(out_.data(), out, v)) {
+          return false;
+        }
+
+        if (rv == Z_STREAM_END) {
+          ended_ = true;
+        } else if (out == 0 && rv == Z_BUF_ERROR) {
+          break;
+        }
+      }
+    }
+    return true;
+  }
+
+#ifdef HAVE_ZSTD
+  if (type_ == COMPRESSION_ZSTD) {
+    ZSTD_inBuffer ib = { in, len, 0 };
+
+    while (ib.pos < ib.size) {
+      ZSTD_outBuffer ob = { out_.data(), out_.size(), 0 };
+      size_t rv = ZSTD_decompressStream(zds_, &ob, &ib);
+
+      if (ZSTD_isError(rv)) {
+        error_ = ZSTD_getErrorName(rv);
+        return false;
+      }
+      if (ob.pos > 0 && !cb(out_.data(), ob.pos, v)) {
+        return false;
+      }
+
+      /* 0 means a frame was completed */
+      ended_ = (rv == 0);
+    }
+
+    /* output that didn't fit into the last block */
+    while (!ended_) {
+      ZSTD_outBuffer ob = { out_.data(), out_.size(), 0 };
+      ZSTD_inBuffer none = { in, 0, 0 };
+      size_t rv = ZSTD_decompressStream(zds_, &ob, &none);
+
+      if (ZSTD_isError(rv)) {
+        error_ = ZSTD_getErrorName(rv);
+        return false;
+      }
+      if (ob.pos == 0) {
+        break;
+      }
+      if (!cb(out_.data(), ob.pos, v)) {
+        return false;
+      }
+      ended_ = (rv == 0);
+    }
+    return true;
+  }
+#endif
+
+  return false;
+}
+
+bool decompressor::finish()
+{
+  if (error_.empty() && !ended_) {
+    error_ = "unexpected end of compressed data";
+  }
+  return error_.empty();
+}
+
+static bool append_cb(const char *data, size_t len, void *v)
+{
+  reinterpret_cast<std::string *>(v)->append(data, len);
+  return true;
+}
+
+bool decompress_all(compression type, const char *in, size_t len, std::string &out, std::string &err)
+{
+  decompressor d(type);
+
+  if (!d.write(in, len, append_cb, &out) || !d.finish()) {
+    err = d.error();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef DECOMPRESS_HPP
+#define DECOMPRESS_HPP
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+enum compression {
+  COMPRESSION_NONE,
+  COMPRESSION_GZIP,
+  COMPRESSION_ZSTD
+};
+
+/* format of data that starts with `p', by its magic bytes */
+compression detect_compression(const void *p, size_t len);
+
+/* Streaming decompression of gzip and, if built with HAVE_ZSTD, zstd
+ * data. Concatenated streams are decompressed one after another. */
+class decompressor
+{
+  compression type_;
+  z_stream zs_;
+#ifdef HAVE_ZSTD
+  ZSTD_DStream *zds_;
+#endif
+  std::vector<char> out_;
+  bool ended_;  /* at the end of a stream */
+  std::string error_;
+
+public:
+  /* receives a block of output, returns false to stop */
+  typedef bool (*output_cb)(const char *data, size_t len, void *v);
+
+  explicit decompressor(compression type);
+  ~decompressor();
+
+  /* Decompresses the next `len' bytes of input and passes the output to
+   * `cb'. Returns false on an error or if `cb' returned false. */
+  bool write(const char *in, size_t len, output_cb cb, void *v);
+
+  /* returns false if the input ended in the middle of a stream */
+  bool finish();
+
+  const std::string &error() const { return error_; }
+};
+
+/* Decompresses a whole buffer into `out'; returns false and sets `err'
+ * on an error. */
+bool decompress_all(compression type, const char *in, size_t len, std::string &out, std::string &err);
+
+#endif  /* !DECOMPRESS_HPP */
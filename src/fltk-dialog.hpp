@@ -172,6 +172,39 @@ enum {
   LANG_COUNT
 };
 
+struct progress_options {
+  bool pulsate = false;
+  unsigned int multi = 1;
+  std::vector<long> watch_pids;
+  bool autoclose = false;
+  bool hide_cancel = false;
+  double fps = 60;
+  bool stats = false;
+  bool pipe = false;
+  unsigned long long size = 0;  /* expected size of --pipe input in bytes */
+  bool tasks = false;
+  long monitor_pid = -1;
+  std::vector<int> fds;
+  const char *shm = NULL;
+  const char *match = NULL;  /* --match pattern, presets already resolved */
+  const char *timing = NULL;  /* file name or descriptor number */
+  size_t log = 0;  /* lines kept in the --log pane, 0 if disabled */
+  std::vector<std::string> copy;  /* --copy SRC... DST */
+};
+
+struct textinfo_options {
+  bool autoscroll = false;
+  const char *checkbox = NULL;
+  bool autoclose = false;
+  bool hide_cancel = false;
+  const char *filename = NULL;  /* show this file instead of STDIN */
+  const char *follow = NULL;    /* show this file and what is appended to it */
+  bool tee = false;             /* pass STDIN through to STDOUT */
+  const char *command = NULL;   /* show the output of this command instead of STDIN */
+  size_t max_lines = 0;  /* keep only the last lines or bytes, 0 means no limit */
+  unsigned long long max_bytes = 0;
+};
+
 extern const char *title, *msg, *quote;
 extern bool resizable, position_center, window_taskbar, window_decoration, always_on_top, use_fribidi;
 extern int override_x, override_y, override_w, override_h;
@@ -202,6 +235,7 @@ size_t strlastcasecmp(const char *s1, const char *s2);
 std::string get_random(void);
 bool save_to_temp(const unsigned char *data, const unsigned int data_len, const char *postfix, std::string &path);
 int leap_year(int y);
+double monotonic_seconds(void);
 
 #ifdef HAVE_QT
 void *dlopen_qtplugin(std::string &plugin, void * &handle, const char *func);
@@ -227,8 +261,9 @@ int dialog_font(void);
 int dialog_html_viewer(const char *file);
 int dialog_indicator(const char *command, const char *indicator_icon, int native, bool listen, bool auto_close);
 int dialog_notify(const char *appname, int timeout, const char *notify_icon, bool libnotify);
-int dialog_progress(bool pulsate, unsigned int multi, long kill_pid, bool autoclose, bool hide_cancel);
-int dialog_textinfo(bool autoscroll, const char *checkbox, bool autoclose, bool hide_cancel);
+int dialog_progress(const progress_options &opt);
+int progress_shm_update(const char *name, const char *line);
+int dialog_textinfo(const textinfo_options &opt);
 int dialog_radiolist(std::string radiolist_options, bool return_number, char separator);
 
 char *file_chooser(int mode);
@@ -22,6 +22,14 @@
  * SOFTWARE.
  */
 
+#include <iostream>
+#include <string>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "decompress.hpp"
 #include "fltk-dialog.hpp"
 
 class help_dialog : public Fl_Help_Dialog
@@ -35,10 +43,54 @@ public:
   }
 };
 
+/* Reads and decompresses `file' if it is compressed; returns false if it
+ * isn't, so it can be loaded as usual. */
+static bool load_compressed(const char *file, std::string &text)
+{
+  std::string data, err;
+  char buf[64*1024];
+  compression type;
+  ssize_t n;
+  int fd;
+
+  if ((fd = open(file, O_RDONLY|O_CLOEXEC)) == -1) {
+    return false;
+  }
+
+  if ((n = pread(fd, buf, 4, 0)) < 2 || (type = detect_compression(buf, n)) == COMPRESSION_NONE) {
+    close(fd);
+    return false;
+  }
+
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    data.append(buf, n);
+  }
+  close(fd);
+
+  if (!decompress_all(type, data.data(), data.size(), text, err)) {
+    std::cerr << "error: " << file << ": " << err << std::endl;
+  }
+
+  return true;
+}
+
 int dialog_html_viewer(const char *file)
 {
   help_dialog *o = new help_dialog();
-  o->load(file);
+  std::string text;
+
+  /* links relative to a compressed file aren't resolved */
+  if (load_compressed(file, text)) {
+    o->value(text.c_str());
+  } else {
+    o->load(file);
+  }
 
   if (!window_taskbar) {
     o->border(0);
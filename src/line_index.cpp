@@ -0,0 +1,140 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#include "line_index.hpp"
+
+/* slices smaller than this aren't worth a thread */
+#define MIN_SLICE (1024*1024)
+
+void find_line_starts(const char *map, size_t from, size_t to, std::vector<uint64_t> &starts)
+{
+  const char *p = map + from;
+  const char *end = map + to;
+
+#ifdef __SSE2__
+  const __m128i nl = _mm_set1_epi8('\n');
+
+  while (p < end && (reinterpret_cast<uintptr_t>(p) & 15) != 0) {
+    if (*p++ == '\n') {
+      starts.push_back(p - map);
+    }
+  }
+
+  /* 64 bytes per step: one compare per 16 bytes and a bit per byte,
+   * so long lines cost almost nothing and short lines no function
+   * call per line like memchr() would */
+  for ( ; end - p >= 64; p += 64) {
+    uint64_t m0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(p)), nl));
+    uint64_t m1 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(p + 16)), nl));
+    uint64_t m2 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(p + 32)), nl));
+    uint64_t m3 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(p + 48)), nl));
+    uint64_t mask = m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+
+    while (mask != 0) {
+      starts.push_back(p - map + __builtin_ctzll(mask) + 1);
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (const char *nl_p; p < end && (nl_p = reinterpret_cast<const char *>(memchr(p, '\n', end - p))); ) {
+    p = nl_p + 1;
+    starts.push_back(p - map);
+  }
+}
+
+struct slice {
+  const char *map;
+  size_t from, to;
+  std::vector<uint64_t> starts;
+};
+
+extern "C" void *find_line_starts_thread(void *v)
+{
+  slice *s = reinterpret_cast<slice *>(v);
+  find_line_starts(s->map, s->from, s->to, s->starts);
+  return nullptr;
+}
+
+void find_line_starts_parallel(const char *map, size_t from, size_t to, int threads,
+                               std::vector<uint64_t> &starts)
+{
+  size_t len = to - from;
+  size_t n = (threads > 1) ? threads : 1;
+  size_t total = starts.size();
+
+  if (n > len / MIN_SLICE) {
+    n = len / MIN_SLICE;
+  }
+
+  if (n < 2) {
+    find_line_starts(map, from, to, starts);
+    return;
+  }
+
+  std::vector<slice> slices(n);
+  std::vector<pthread_t> tids(n);
+  std::vector<bool> started(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    slices[i].map = map;
+    slices[i].from = from + len * i / n;
+    slices[i].to = from + len * (i + 1) / n;
+  }
+
+  /* the first slice is scanned by this thread */
+  for (size_t i = 1; i < n; ++i) {
+    started[i] = (pthread_create(&tids[i], NULL, find_line_starts_thread, &slices[i]) == 0);
+    if (!started[i]) {
+      find_line_starts_thread(&slices[i]);
+    }
+  }
+  find_line_starts_thread(&slices[0]);
+
+  for (size_t i = 1; i < n; ++i) {
+    if (started[i]) {
+      pthread_join(tids[i], NULL);
+    }
+  }
+
+  /* stitch the slices together; the prefix sum of their sizes gives each
+   * slice its place in the result */
+  std::vector<size_t> pos(n);
+  for (size_t i = 0; i < n; ++i) {
+    pos[i] = total;
+    total += slices[i].starts.size();
+  }
+  starts.resize(total);
+  for (size_t i = 0; i < n; ++i) {
+    if (!slices[i].starts.empty()) {
+      memcpy(&starts[pos[i]], slices[i].starts.data(), slices[i].starts.size() * sizeof(uint64_t));
+    }
+  }
+}
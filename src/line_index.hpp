@@ -0,0 +1,41 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LINE_INDEX_HPP
+#define LINE_INDEX_HPP
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Appends the offset of every byte that follows a newline in
+ * map[from..to) to `starts', in ascending order. */
+void find_line_starts(const char *map, size_t from, size_t to, std::vector<uint64_t> &starts);
+
+/* Same as find_line_starts(), but map[from..to) is split into one slice
+ * per thread; the offsets of the slices are concatenated in order. */
+void find_line_starts_parallel(const char *map, size_t from, size_t to, int threads,
+                               std::vector<uint64_t> &starts);
+
+#endif  /* !LINE_INDEX_HPP */
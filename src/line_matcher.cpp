@@ -0,0 +1,405 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "line_matcher.hpp"
+
+/* longer lines are only matched up to this length */
+#define MAX_LINE_LENGTH 4096
+
+static const struct {
+  const char *name;
+  const char *pattern;
+} presets[] = {
+  /* "  1,234,567  45%    1.23MB/s    0:00:12 (xfr#1, to-chk=0/1)" */
+  { "rsync", "%d %p%% %* %e" },
+  /* " 45  100M   45 45.2M    0     0  10.1M      0  0:00:09  0:00:04  0:00:05 10.1M" */
+  { "curl", "^ %p %t %p %d" },
+  /* "foo.iso   45%[=======>        ]  45.2M  10.1MB/s    eta 5s" */
+  { "wget", "%p%%%*eta %e|%p%%" },
+  /* "  Duration: 00:10:00.00, start: ..." and "frame= 123 ... time=00:01:23.45 ..." */
+  { "ffmpeg", "Duration: %T|time=%D" },
+  { NULL, NULL }
+};
+
+static inline bool is_digit(char c) {
+  return (c >= '0' && c <= '9');
+}
+
+/* "42", "42.7", "1,234,567" */
+static const char *parse_number(const char *p, const char *end, double &value)
+{
+  double frac = 0.1;
+
+  if (p >= end || !is_digit(*p)) {
+    return NULL;
+  }
+
+  for (value = 0; p < end; ++p) {
+    if (is_digit(*p)) {
+      value = value * 10 + (*p - '0');
+    } else if (*p == ',' && end - p > 3 && is_digit(p[1]) && is_digit(p[2]) && is_digit(p[3]) &&
+               (end - p == 4 || !is_digit(p[4])))
+    {
+      continue;  /* thousands separator */
+    } else {
+      break;
+    }
+  }
+
+  if (p + 1 < end && *p == '.' && is_digit(p[1])) {
+    for (++p; p < end && is_digit(*p); ++p, frac /= 10) {
+      value += (*p - '0') * frac;
+    }
+  }
+
+  return p;
+}
+
+static inline bool is_alpha(char c) {
+  return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'));
+}
+
+/* number with an optional unit: "45.2M", "3.1GiB", "512kB", "100B";
+ * the unit is only taken if no other letter follows, so "12total"
+ * isn't read as 12 terabytes */
+static const char *parse_amount(const char *p, const char *end, double &value)
+{
+  const char *units = "KMGTP";
+  const char *u = NULL;
+  const char *q;
+  double scale = 1;
+
+  if ((p = parse_number(p, end, value)) == NULL) {
+    return NULL;
+  }
+
+  /* K, k, M, G, T or P, then "i" and/or "B" */
+  q = p;
+  if (q < end && *q != '\0' && ((u = strchr(units, *q)) != NULL || *q == 'k')) {
+    for (long i = (u ? u - units : 0); i >= 0; --i) {
+      scale *= 1024;
+    }
+    ++q;
+    if (q < end && *q == 'i') {
+      ++q;
+    }
+  }
+
+  if (q < end && (*q == 'B' || *q == 'b')) {
+    ++q;
+  }
+
+  if (q < end && is_alpha(*q)) {
+    return p;  /* a word, not a unit */
+  }
+
+  value *= scale;
+  return q;
+}
+
+/* "01:23:45.67", "4:05", "12s", "1m30s", "2h5m" */
+static const char *parse_time(const char *p, const char *end, double &value)
+{
+  double v;
+  const char *q;
+  int n = 0;
+
+  if ((q = parse_number(p, end, v)) == NULL) {
+    return NULL;
+  }
+
+  if (q < end && (*q == 'h' || *q == 'm' || *q == 's' || *q == 'd')) {
+    /* "1h2m3s" */
+    for (value = 0; q && q < end; ) {
+      switch (*q) {
+        case 'd': value += v * 86400; break;
+        case 'h': value += v * 3600; break;
+        case 'm': value += v * 60; break;
+        case 's': value += v; break;
+        default: return q;
+      }
+      p = ++q;
+      while (q < end && *q == ' ') {
+        ++q;  /* "1m 5s" */
+      }
+      if ((q = parse_number(q, end, v)) == NULL) {
+        return p;
+      }
+    }
+    return p;
+  }
+
+  /* "[[h:]m:]s" */
+  for (value = v; q < end && *q == ':' && n < 2; ++n) {
+    if ((p = parse_number(q + 1, end, v)) == NULL) {
+      break;
+    }
+    value = value * 60 + v;
+    q = p;
+  }
+
+  return q;
+}
+
+const char *line_matcher::preset(const char *name)
+{
+  for (int i = 0; presets[i].name; ++i) {
+    if (strcmp(name, presets[i].name) == 0) {
+      return presets[i].pattern;
+    }
+  }
+  return NULL;
+}
+
+bool line_matcher::compile(const char *pattern, std::string &error)
+{
+  alternative *a = NULL;
+  token *lit = NULL;
+  bool have_capture = false;
+
+  alt_count_ = 0;
+
+  for (const char *p = pattern; ; ++p) {
+    token_type type;
+    char c = *p;
+
+    if (!a) {
+      if (alt_count_ == MAX_ALTERNATIVES) {
+        error = "too many alternatives";
+        return false;
+      }
+      a = &alt_[alt_count_++];
+      a->count = 0;
+      a->anchored = (c == '^');
+      lit = NULL;
+      have_capture = false;
+
+      if (a->anchored) {
+        continue;
+      }
+    }
+
+    if (c == '\0' || c == '|') {
+      if (!have_capture) {
+        error = "pattern doesn't contain any of %p, %d, %t, %D, %T or %e";
+        return false;
+      }
+      if (c == '\0') {
+        break;
+      }
+      a = NULL;
+      continue;
+    }
+
+    if (c == '%') {
+      switch (*++p) {
+        case 'p': type = T_PERCENT; break;
+        case 'd': type = T_DONE; break;
+        case 't': type = T_TOTAL; break;
+        case 'D': type = T_TIME_DONE; break;
+        case 'T': type = T_TIME_TOTAL; break;
+        case 'e': type = T_ETA; break;
+        case '*': type = T_ANY; break;
+        case '%':
+        case '|':
+          type = T_LITERAL;
+          c = *p;
+          break;
+        default:
+          error = std::string("unknown placeholder: %") + *p;
+          return false;
+      }
+      if (type != T_LITERAL && type != T_ANY) {
+        have_capture = true;
+      }
+    } else if (isspace(c)) {
+      type = T_SPACE;
+      while (isspace(p[1])) {
+        ++p;
+      }
+    } else {
+      type = T_LITERAL;
+    }
+
+    if (type == T_LITERAL && lit) {
+      if (lit->len == MAX_LITERAL - 1) {
+        error = "literal text too long";
+        return false;
+      }
+      lit->text[lit->len++] = c;
+      lit->text[lit->len] = '\0';
+      continue;
+    }
+
+    if (a->count == MAX_TOKENS) {
+      error = "pattern too long";
+      return false;
+    }
+
+    token &t = a->tokens[a->count++];
+    t.type = type;
+    t.len = 0;
+    t.text[0] = '\0';
+    lit = NULL;
+
+    if (type == T_LITERAL) {
+      t.text[t.len++] = c;
+      t.text[t.len] = '\0';
+      lit = &t;
+    }
+  }
+
+  return true;
+}
+
+bool line_matcher::match_at(const alternative &a, const char *p, const char *end, line_match &m) const
+{
+  line_match r = m;
+  double v = 0;
+
+  r.found = 0;
+
+  for (int i = 0; i < a.count; ++i) {
+    const token &t = a.tokens[i];
+
+    switch (t.type) {
+      case T_LITERAL:
+        if (static_cast<size_t>(end - p) < t.len || memcmp(p, t.text, t.len) != 0) {
+          return false;
+        }
+        p += t.len;
+        continue;
+
+      case T_SPACE:
+        while (p < end && isspace(*p)) {
+          ++p;
+        }
+        continue;
+
+      case T_ANY:
+        /* skip up to whatever the next token can start with */
+        if (i + 1 == a.count) {
+          p = end;
+        } else if (a.tokens[i + 1].type == T_LITERAL) {
+          const token &next = a.tokens[i + 1];
+          p = reinterpret_cast<const char *>(memmem(p, end - p, next.text, next.len));
+          if (!p) {
+            return false;
+          }
+        } else if (a.tokens[i + 1].type == T_SPACE) {
+          while (p < end && !isspace(*p)) {
+            ++p;
+          }
+        } else {
+          while (p < end && !is_digit(*p)) {
+            ++p;
+          }
+        }
+        continue;
+
+      case T_PERCENT:
+        p = parse_number(p, end, v);
+        r.percent = v;
+        r.found |= line_match::PERCENT;
+        break;
+
+      case T_DONE:
+        p = parse_amount(p, end, v);
+        r.done = v;
+        r.found |= line_match::DONE;
+        break;
+
+      case T_TOTAL:
+        p = parse_amount(p, end, v);
+        r.total = v;
+        r.found |= line_match::TOTAL;
+        break;
+
+      case T_TIME_DONE:
+        p = parse_time(p, end, v);
+        r.done = v;
+        r.found |= line_match::DONE;
+        break;
+
+      case T_TIME_TOTAL:
+        p = parse_time(p, end, v);
+        r.total = v;
+        r.found |= line_match::TOTAL;
+        break;
+
+      case T_ETA:
+        p = parse_time(p, end, v);
+        r.eta = v;
+        r.found |= line_match::ETA;
+        break;
+    }
+
+    if (!p) {
+      return false;
+    }
+  }
+
+  m = r;
+  return true;
+}
+
+bool line_matcher::match(const char *line, size_t len, line_match &m) const
+{
+  const char *end = line + ((len > MAX_LINE_LENGTH) ? MAX_LINE_LENGTH : len);
+
+  for (int i = 0; i < alt_count_; ++i) {
+    const alternative &a = alt_[i];
+    const token &first = a.tokens[0];
+
+    if (a.anchored || first.type == T_SPACE || first.type == T_ANY) {
+      if (match_at(a, line, end, m)) {
+        return true;
+      }
+    } else if (first.type == T_LITERAL) {
+      for (const char *p = line; p < end; ++p) {
+        p = reinterpret_cast<const char *>(memmem(p, end - p, first.text, first.len));
+        if (!p) {
+          break;
+        }
+        if (match_at(a, p, end, m)) {
+          return true;
+        }
+      }
+    } else {
+      /* starts with a number, try the start of each number */
+      for (const char *p = line; p < end; ++p) {
+        if (is_digit(*p) && (p == line || (!is_digit(p[-1]) && p[-1] != '.' && p[-1] != ',')) &&
+            match_at(a, p, end, m))
+        {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,113 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LINE_MATCHER_HPP
+#define LINE_MATCHER_HPP
+
+#include <stddef.h>
+#include <string>
+
+/* Values picked from a line; `found' tells which of them were matched.
+ * Unmatched values keep the content of an earlier match, so a total can
+ * come from a different line than the progress. */
+struct line_match {
+  enum {
+    PERCENT = 1 << 0,
+    DONE    = 1 << 1,
+    TOTAL   = 1 << 2,
+    ETA     = 1 << 3
+  };
+  unsigned int found;
+  double percent, done, total, eta;
+};
+
+/* A pattern is literal text with the following placeholders:
+ *   %p  percentage ("42", "42.7")
+ *   %d  amount done, %t  total amount ("1,234,567", "45.2M", "3.1GiB")
+ *   %D  time done, %T  total time ("01:23:45.67", "4:05")
+ *   %e  time left ("0:00:12", "12s")
+ *   %*  skip any text
+ *   %%  a literal "%", %|  a literal "|"
+ * A space matches any amount of whitespace, "^" at the start anchors the
+ * pattern to the start of the line and "|" separates alternatives.
+ *
+ * The pattern is compiled once into a fixed array of tokens and matching
+ * never allocates.  A match is tried from every occurrence of the first
+ * literal (or the start of every number), so a pathological line costs
+ * up to its length squared times the number of tokens; lines are only
+ * matched up to their first 4096 bytes to keep that bounded.
+ */
+class line_matcher
+{
+  enum {
+    MAX_TOKENS = 32,
+    MAX_ALTERNATIVES = 4,
+    MAX_LITERAL = 64
+  };
+
+  enum token_type {
+    T_LITERAL,
+    T_SPACE,
+    T_ANY,
+    T_PERCENT,
+    T_DONE,
+    T_TOTAL,
+    T_TIME_DONE,
+    T_TIME_TOTAL,
+    T_ETA
+  };
+
+  struct token {
+    token_type type;
+    size_t len;
+    char text[MAX_LITERAL];
+  };
+
+  struct alternative {
+    token tokens[MAX_TOKENS];
+    int count;
+    bool anchored;
+  };
+
+  alternative alt_[MAX_ALTERNATIVES];
+  int alt_count_;
+
+  bool match_at(const alternative &a, const char *p, const char *end, line_match &m) const;
+
+public:
+  line_matcher() : alt_count_(0) {}
+
+  /* returns the pattern of a preset (rsync, curl, wget, ffmpeg), or NULL */
+  static const char *preset(const char *name);
+
+  /* returns false and sets `error' if the pattern is invalid */
+  bool compile(const char *pattern, std::string &error);
+
+  bool empty() const { return alt_count_ == 0; }
+
+  /* returns true if the line matched; the results are written into `m' */
+  bool match(const char *line, size_t len, line_match &m) const;
+};
+
+#endif  /* !LINE_MATCHER_HPP */
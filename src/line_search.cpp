@@ -0,0 +1,248 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <algorithm>
+#include <string.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#ifdef __GNUC__
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wshadow"
+# pragma GCC diagnostic ignored "-Wunused-parameter"
+# if __GNUC__ > 7
+#  pragma GCC diagnostic ignored "-Wcast-function-type"
+# endif
+#endif
+#include <FL/Fl.H>
+#ifdef __GNUC__
+# pragma GCC diagnostic pop
+#endif
+
+#include "line_search.hpp"
+
+/* lines scanned per chunk, i.e. per time the lock is taken */
+#define CHUNK_LINES 16384
+
+const char *find_substring(const char *text, size_t len, const char *needle, size_t n)
+{
+  const char *p = text;
+
+  if (n == 0) {
+    return text;
+  }
+  if (n > len) {
+    return NULL;
+  }
+  if (n == 1) {
+    return reinterpret_cast<const char *>(memchr(text, needle[0], len));
+  }
+
+#ifdef __SSE2__
+  /* Compares the first and the last byte of the needle with 16 positions
+   * at once; memcmp() is only called for the positions where both match,
+   * which in text is rare. */
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[n - 1]);
+  const char *end = text + len - n + 1;  /* last position + 1 */
+
+  for ( ; end - p >= 16; p += 16) {
+    __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), first);
+    __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n - 1)), last);
+    unsigned int mask = _mm_movemask_epi8(_mm_and_si128(a, b));
+
+    while (mask != 0) {
+      int i = __builtin_ctz(mask);
+      if (memcmp(p + i + 1, needle + 1, n - 2) == 0) {
+        return p + i;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  return reinterpret_cast<const char *>(memmem(p, text + len - p, needle, n));
+}
+
+static size_t count_newlines(const char *p, size_t len)
+{
+  const char *end = p + len;
+  size_t count = 0;
+
+#ifdef __SSE2__
+  const __m128i nl = _mm_set1_epi8('\n');
+
+  for ( ; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+  }
+#endif
+
+  for ( ; p < end; ++p) {
+    if (*p == '\n') {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+extern "C" void *line_search_thread(void *v)
+{
+  reinterpret_cast<line_search *>(v)->run();
+  return nullptr;
+}
+
+line_search::line_search(line_store *store)
+ : store_(store),
+   next_(0),
+   pruned_(0),
+   cb_(NULL),
+   cb_data_(NULL),
+   started_(false),
+   pending_(false)
+{
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&cond_, NULL);
+}
+
+/* scans the next chunk, returns false if nothing is left */
+bool line_search::step()
+{
+  uint64_t first, line;
+  size_t count = CHUNK_LINES, len;
+  const char *block, *p, *end, *hit;
+
+  prune();
+
+  if (!busy()) {
+    return false;
+  }
+
+  first = next_ - store_->evicted();
+  block = store_->block(first, count, len);
+  p = block;
+  end = block + len;
+  line = next_;
+
+  /* The needle holds no newline, so a match never spans two lines. The
+   * line of a match is found by counting the newlines in front of it, and
+   * the search goes on behind the end of that line. */
+  while ((hit = find_substring(p, end - p, needle_.data(), needle_.size())) != NULL) {
+    const char *nl;
+
+    line += count_newlines(p, hit - p);
+    matches_.push_back(line);
+
+    if ((nl = reinterpret_cast<const char *>(memchr(hit, '\n', end - hit))) == NULL) {
+      break;
+    }
+    p = nl + 1;
+    line++;
+  }
+
+  next_ += count;
+
+  return busy();
+}
+
+void line_search::run()
+{
+  for (;;) {
+    bool more = true;
+
+    pthread_mutex_lock(&mutex_);
+    while (!pending_) {
+      pthread_cond_wait(&cond_, &mutex_);
+    }
+    pending_ = false;
+    pthread_mutex_unlock(&mutex_);
+
+    while (more) {
+      Fl::lock();
+      more = step();
+      if (cb_) {
+        cb_(cb_data_);
+      }
+      Fl::unlock();
+      Fl::awake();
+    }
+  }
+}
+
+void line_search::start(const char *needle)
+{
+  needle_ = needle;
+  matches_.clear();
+  next_ = store_->evicted();
+  notify();
+}
+
+void line_search::notify()
+{
+  if (needle_.empty()) {
+    if (cb_) {
+      cb_(cb_data_);
+    }
+    return;
+  }
+
+  if (!started_) {
+    started_ = (pthread_create(&tid_, NULL, line_search_thread, this) == 0);
+
+    /* scan on this thread then */
+    if (!started_) {
+      while (step()) {}
+      if (cb_) {
+        cb_(cb_data_);
+      }
+      return;
+    }
+  }
+
+  pthread_mutex_lock(&mutex_);
+  pending_ = true;
+  pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+size_t line_search::lower_bound(size_t n) const
+{
+  return std::lower_bound(matches_.begin(), matches_.end(), store_->evicted() + n) - matches_.begin();
+}
+
+uint64_t line_search::prune()
+{
+  uint64_t evicted = store_->evicted();
+
+  if (next_ < evicted) {
+    next_ = evicted;
+  }
+  while (!matches_.empty() && matches_.front() < evicted) {
+    matches_.pop_front();
+    pruned_++;
+  }
+
+  return pruned_;
+}
@@ -0,0 +1,94 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef LINE_SEARCH_HPP
+#define LINE_SEARCH_HPP
+
+#include <deque>
+#include <string>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "line_store.hpp"
+
+/* Returns the first occurrence of `needle' in `text', or NULL. */
+const char *find_substring(const char *text, size_t len, const char *needle, size_t n);
+
+/* Finds the lines of a line_store that contain a string. The store is
+ * scanned on a thread of its own in chunks; the thread holds the FLTK lock
+ * (which also guards the store) only while it scans one chunk, so the
+ * event loop keeps running during a search over millions of lines. Lines
+ * appended later are scanned as they arrive. Except for the thread, all
+ * members have to be called with the FLTK lock held. */
+class line_search
+{
+  line_store *store_;
+  std::string needle_;
+  std::deque<uint64_t> matches_;  /* line numbers counted since the start */
+  uint64_t next_, pruned_;
+  void (*cb_)(void *);
+  void *cb_data_;
+
+  pthread_t tid_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  bool started_, pending_;
+
+  bool step();
+
+public:
+  line_search(line_store *store);
+
+  /* called with the lock held after every chunk that was scanned */
+  void callback(void (*cb)(void *), void *data) { cb_ = cb; cb_data_ = data; }
+
+  /* starts a new search, an empty string stops searching */
+  void start(const char *needle);
+
+  /* call after lines were added to the store */
+  void notify();
+
+  /* the thread's loop */
+  void run();
+
+  const std::string &needle() const { return needle_; }
+
+  /* true while lines are left to scan */
+  bool busy() const { return !needle_.empty() && next_ < store_->evicted() + store_->size(); }
+
+  /* number of matching lines */
+  size_t count() const { return matches_.size(); }
+
+  /* store index of the matching line `i' */
+  size_t match(size_t i) const { return matches_[i] - store_->evicted(); }
+
+  /* index of the first matching line at or after store index `n' */
+  size_t lower_bound(size_t n) const;
+
+  /* Forgets the matches of lines that were dropped from the store and
+   * returns how many were forgotten so far. */
+  uint64_t prune();
+};
+
+#endif  /* !LINE_SEARCH_HPP */
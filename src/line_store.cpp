@@ -0,0 +1,229 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#include "line_store.hpp"
+
+/* text is copied into segments of this size; longer lines get their own */
+#define SEGMENT_SIZE (1024*1024)
+
+const line_store::segment &line_store::find(uint64_t abs) const
+{
+  size_t lo = 0, hi = segs_.size() - 1;
+
+  /* most lookups are for the lines at the end */
+  if (abs >= segs_[hi].first_line) {
+    return segs_[hi];
+  }
+
+  /* last segment with first_line <= abs */
+  while (lo < hi) {
+    size_t mid = (lo + hi + 1) / 2;
+
+    if (segs_[mid].first_line <= abs) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  return segs_[lo];
+}
+
+void line_store::append(const char *text, size_t len, const style_run *runs, size_t nruns)
+{
+  if (segs_.empty() || !segs_.back().data || segs_.back().size + len + 1 > segs_.back().capacity) {
+    segment s;
+
+    s.capacity = (len + 1 > SEGMENT_SIZE) ? len + 1 : SEGMENT_SIZE;
+    s.data = reinterpret_cast<char *>(malloc(s.capacity));
+    if (!s.data) {
+      return;
+    }
+    s.base = s.data;
+    s.size = 0;
+    s.first_line = lines_;
+    segs_.push_back(s);
+  }
+
+  segment &s = segs_.back();
+
+  memcpy(s.data + s.size, text, len);
+  s.data[s.size + len] = '\n';
+  s.starts.push_back(s.size);
+  s.size += len + 1;
+
+  if (nruns > 0) {
+    s.styled.push_back(s.starts.size() - 1);
+    s.run_start.push_back(s.runs.size());
+    s.runs.insert(s.runs.end(), runs, runs + nruns);
+  }
+
+  if (len > max_len_) {
+    max_len_ = len;
+  }
+  lines_++;
+  bytes_ += len + 1;
+
+  enforce_limits();
+}
+
+void line_store::append_mapped(const char *map, const uint64_t *starts, size_t count, uint64_t end)
+{
+  for (size_t i = 0; i < count; ++i) {
+    const char *p = map + starts[i];
+    uint64_t line_end = (i + 1 < count) ? starts[i + 1] : end;
+    size_t len = line_end - starts[i];
+
+    /* offsets within a segment have to fit into 32 bits */
+    if (segs_.empty() || segs_.back().data || p - segs_.back().base > UINT32_MAX) {
+      segment s;
+
+      s.data = NULL;
+      s.base = p;
+      s.size = s.capacity = 0;
+      s.first_line = lines_;
+      segs_.push_back(s);
+    }
+
+    segment &s = segs_.back();
+
+    s.starts.push_back(p - s.base);
+    s.size = map + line_end - s.base;
+    lines_++;
+    bytes_ += len;
+
+    if (len > 0 && map[line_end - 1] == '\n') {
+      len--;
+    }
+    if (len > max_len_) {
+      max_len_ = len;
+    }
+  }
+
+  enforce_limits();
+}
+
+void line_store::evict_front()
+{
+  segment &s = segs_.front();
+  size_t i = evicted_ - s.first_line;
+  size_t end = (i + 1 < s.starts.size()) ? s.starts[i + 1] : s.size;
+  size_t len = end - s.starts[i];
+
+  bytes_ = (bytes_ > len) ? bytes_ - len : 0;
+  evicted_++;
+
+  if (i + 1 == s.starts.size()) {
+    free(s.data);
+    segs_.pop_front();
+  }
+}
+
+void line_store::enforce_limits()
+{
+  while ((max_lines_ > 0 && size() > max_lines_) || (max_bytes_ > 0 && bytes_ > max_bytes_ && size() > 1)) {
+    evict_front();
+  }
+}
+
+void line_store::limit(size_t lines, size_t bytes)
+{
+  max_lines_ = lines;
+  max_bytes_ = bytes;
+  enforce_limits();
+}
+
+const char *line_store::line(size_t n, size_t &len) const
+{
+  uint64_t abs = evicted_ + n;
+  const segment &s = find(abs);
+  size_t i = abs - s.first_line;
+  size_t start = s.starts[i];
+  size_t end = (i + 1 < s.starts.size()) ? s.starts[i + 1] : s.size;
+
+  /* strip "\n" or "\r\n" */
+  if (end > start && s.base[end - 1] == '\n') {
+    end--;
+  }
+  if (end > start && s.base[end - 1] == '\r') {
+    end--;
+  }
+
+  len = end - start;
+  return s.base + start;
+}
+
+const char *line_store::block(size_t n, size_t &count, size_t &len) const
+{
+  uint64_t abs = evicted_ + n;
+  const segment &s = find(abs);
+  size_t i = abs - s.first_line;
+  size_t end;
+
+  if (count > s.starts.size() - i) {
+    count = s.starts.size() - i;
+  }
+  end = (i + count < s.starts.size()) ? s.starts[i + count] : s.size;
+
+  len = end - s.starts[i];
+  return s.base + s.starts[i];
+}
+
+const style_run *line_store::styles(size_t n, size_t &count) const
+{
+  uint64_t abs = evicted_ + n;
+  const segment &s = find(abs);
+  uint32_t i = abs - s.first_line;
+  std::vector<uint32_t>::const_iterator it;
+  size_t k, end;
+
+  if (s.styled.empty()) {
+    return NULL;
+  }
+
+  it = std::lower_bound(s.styled.begin(), s.styled.end(), i);
+  if (it == s.styled.end() || *it != i) {
+    return NULL;
+  }
+
+  k = it - s.styled.begin();
+  end = (k + 1 < s.run_start.size()) ? s.run_start[k + 1] : s.runs.size();
+  count = end - s.run_start[k];
+
+  return &s.runs[s.run_start[k]];
+}
+
+void line_store::clear()
+{
+  for (size_t i = 0; i < segs_.size(); ++i) {
+    free(segs_[i].data);
+  }
+  segs_.clear();
+  lines_ = evicted_ = bytes_ = 0;
+  max_len_ = 0;
+}
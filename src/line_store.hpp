@@ -0,0 +1,106 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LINE_STORE_HPP
+#define LINE_STORE_HPP
+
+#include <deque>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "text_style.hpp"
+
+
+/* Text lines in large contiguous segments plus a compact index of
+ * 32 bit line offsets per segment. A line costs its length, one newline
+ * and 4 bytes of index, compared to a heap node per line in Fl_Browser.
+ * Lines can also point into a memory mapped file, which then costs only
+ * the index. The store is not thread safe, callers have to lock it. */
+class line_store
+{
+  struct segment {
+    char *data;            /* owned text, or NULL */
+    const char *base;
+    size_t size, capacity;
+    uint64_t first_line;   /* number of the first line since the start */
+    std::vector<uint32_t> starts;
+
+    /* Style runs of the few lines that have them: line `styled[i]' has
+     * the runs from `run_start[i]' up to the next line's first run. */
+    std::vector<uint32_t> styled, run_start;
+    std::vector<style_run> runs;
+  };
+
+  std::deque<segment> segs_;
+  uint64_t lines_, evicted_, bytes_;
+  size_t max_len_, max_lines_, max_bytes_;
+
+  const segment &find(uint64_t abs) const;
+  void evict_front();
+  void enforce_limits();
+
+public:
+  line_store() : lines_(0), evicted_(0), bytes_(0), max_len_(0), max_lines_(0), max_bytes_(0) {}
+  ~line_store() { clear(); }
+
+  /* number of lines */
+  size_t size() const { return lines_ - evicted_; }
+
+  /* number of lines dropped from the front so far */
+  uint64_t evicted() const { return evicted_; }
+
+  /* Keeps at most `lines' lines and `bytes' bytes of text by dropping the
+   * oldest lines, 0 means no limit. Dropping a line is O(1); a segment is
+   * freed as soon as all of its lines are gone. */
+  void limit(size_t lines, size_t bytes);
+
+  /* length of the longest line in bytes */
+  size_t max_length() const { return max_len_; }
+
+  /* appends a line, `len' doesn't include a newline; `runs' are the
+   * line's style runs, ordered by offset */
+  void append(const char *text, size_t len, const style_run *runs = NULL, size_t nruns = 0);
+
+  /* Appends `count' lines of a memory mapped file, given as the offsets
+   * of their first bytes in ascending order. A line ends where the next
+   * one starts, the last one at offset `end'; it must not run into text
+   * that wasn't indexed yet. */
+  void append_mapped(const char *map, const uint64_t *starts, size_t count, uint64_t end);
+
+  /* returns line `n' (counting from 0) and its length without the newline */
+  const char *line(size_t n, size_t &len) const;
+
+  /* Returns the text of lines `n' to `n+count-1' as one block of `len'
+   * bytes, the lines separated by newlines. `count' is reduced if the
+   * lines don't lie in one segment. */
+  const char *block(size_t n, size_t &count, size_t &len) const;
+
+  /* returns the style runs of line `n', or NULL if it has none */
+  const style_run *styles(size_t n, size_t &count) const;
+
+  void clear();
+};
+
+#endif  /* !LINE_STORE_HPP */
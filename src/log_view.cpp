@@ -0,0 +1,75 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "log_view.hpp"
+
+#ifdef __GNUC__
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wshadow"
+# pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#include <FL/fl_draw.H>
+#ifdef __GNUC__
+# pragma GCC diagnostic pop
+#endif
+
+log_view::log_view(int X, int Y, int W, int H, size_t capacity)
+ : row_view(X, Y, W, H),
+   lines_((capacity > 0) ? capacity : 1),
+   first_(0),
+   count_(0)
+{
+  labelfont(FL_COURIER);
+  labelsize(FL_NORMAL_SIZE - 2);
+  row_height(labelsize() + 4);
+  update_scrollbar(0);
+}
+
+void log_view::add(std::string &s)
+{
+  int top = top_row();
+  bool follow = (top >= static_cast<int>(count_) - visible_rows());
+
+  if (count_ < lines_.size()) {
+    lines_[(first_ + count_) % lines_.size()].swap(s);
+    count_++;
+  } else {
+    /* full: overwrite the oldest line, the view keeps showing the same lines */
+    lines_[first_].swap(s);
+    first_ = (first_ + 1) % lines_.size();
+    top--;
+  }
+  s.clear();
+
+  update_scrollbar(follow ? count_ : top);
+}
+
+void log_view::draw_row(size_t i, int X, int Y, int, int H)
+{
+  const std::string &s = line(i);
+
+  fl_font(labelfont(), labelsize());
+  fl_color(active_r() ? FL_FOREGROUND_COLOR : fl_inactive(FL_FOREGROUND_COLOR));
+  fl_draw(s.c_str(), s.size(), X + 3, Y + H - fl_descent() - 2);
+}
@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_VIEW_HPP
+#define LOG_VIEW_HPP
+
+#include <string>
+#include <vector>
+
+#include "row_view.hpp"
+
+
+/* A scrolling view of the last lines of a log. The lines are kept in a
+ * ring buffer of fixed capacity, so the oldest line is dropped for every
+ * new one once it's full. The view follows new lines unless it was
+ * scrolled up. */
+class log_view : public row_view
+{
+  std::vector<std::string> lines_;
+  size_t first_, count_;
+
+  const std::string &line(size_t n) const { return lines_[(first_ + n) % lines_.size()]; }
+
+protected:
+  size_t rows() const { return count_; }
+  void draw_row(size_t i, int X, int Y, int W, int H);
+
+public:
+  log_view(int X, int Y, int W, int H, size_t capacity);
+
+  size_t size() const { return count_; }
+
+  /* Appends a line by swapping it into the ring; `s' receives the string
+   * of an evicted line, so a full log reuses its memory. Doesn't redraw. */
+  void add(std::string &s);
+};
+
+#endif  /* !LOG_VIEW_HPP */
@@ -30,10 +30,12 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "fltk-dialog.hpp"
+#include "line_matcher.hpp"
 #include "icon_png.h"
 
 typedef args::Flag ARG_T;
@@ -78,6 +80,32 @@ static int esc_handler(int event) {
   return 0;
 }
 
+/* "1536", "1.5K", "2G" */
+static int _argtosize(const char *arg, unsigned long long &val, const char *self, std::string cmd)
+{
+  const char *suffixes = "KMGT";
+  const char *s;
+  char *p;
+  double d = strtod(arg, &p);
+
+  if (p == arg || d < 0) {
+    std::cerr << self << ": " << cmd << ": input is not a valid size" << std::endl;
+    return 1;
+  }
+
+  if (*p) {
+    if (p[1] != '\0' || (s = strchr(suffixes, toupper(*p))) == NULL) {
+      std::cerr << self << ": " << cmd << ": unknown size suffix: " << p << std::endl;
+      return 1;
+    }
+    for (long i = s - suffixes; i >= 0; --i) {
+      d *= 1024;
+    }
+  }
+  val = d;
+  return 0;
+}
+
 #define STRINGTOINT(s, a, b)  if (_argtoint(s.c_str(), a, argv[0], b)) { return 1; }
 static int _argtoint(const char *arg, int &val, const char *self, std::string cmd)
 {
@@ -187,7 +215,46 @@ int main(int argc, char **argv)
   ARG_T  arg_pulsate(g_progress_options, "pulsate", "Pulsating progress bar", {"pulsate"});
   ARGI_T arg_multi(g_progress_options, "NUMBER", "Use 2 progress bars; the main bar, showing the overall progress, "
                    "will reach 100% if the other bar has reached 100% after NUMBER iterations", {"multi"});
-  ARGL_T arg_watch_pid(g_progress_options, "PID", "Process ID to watch", {"watch-pid"});
+  args::ValueFlagList<long> arg_watch_pid(g_progress_options, "PID", "Process ID to watch; can be used multiple "
+                                          "times; the dialog finishes when all processes have stopped and returns "
+                                          "the exit status of the first failed process if it is known",
+                                          {"watch-pid"});
+  ARGD_T arg_fps(g_progress_options, "NUMBER", "Frame rate used to animate the progress bar; default is 60",
+                 {"fps"});
+  ARG_T  arg_stats(g_progress_options, "stats", "Print the number of received and collapsed updates and the "
+                   "redrawn area per second to stderr when the dialog is closed", {"stats"});
+  ARG_T  arg_pipe(g_progress_options, "pipe", "Pass STDIN through to STDOUT and show the amount of transferred data",
+                  {"pipe"});
+  ARGS_T arg_size(g_progress_options, "BYTES", "Expected size of the --pipe input; suffixes K, M, G and T are "
+                  "accepted", {"size"});
+  ARG_T  arg_tasks(g_progress_options, "tasks", "Show a list of progress bars, one per task; input lines are "
+                   "addressed to a task like \"17:45\" or \"17:#comment\" and the main bar shows the average",
+                   {"tasks"});
+  ARGL_T arg_monitor_pid(g_progress_options, "PID", "Show the progress of a running process (i.e. cp, tar or dd) "
+                         "by sampling the position of the file it reads; use --fd to choose the file descriptor, "
+                         "otherwise the largest file opened for reading is used", {"monitor-pid"});
+  args::ValueFlagList<int> arg_fd(g_progress_options, "FD", "File descriptor of the process given with "
+                                  "--monitor-pid; without --monitor-pid the progress is read from FD instead of "
+                                  "STDIN, can be used multiple times to show one bar per descriptor",
+                                  {"fd"});
+  ARGS_T arg_shm(g_progress_options, "NAME", "Read the progress from a shared memory segment that producers update "
+                 "without any system call (see progress_shm.h); use `--shm=NAME --update=LINE' without `--progress' "
+                 "to update it from a shell script", {"shm"})
+  ,      arg_update(g_progress_options, "LINE", "Progress update to write into the shared memory segment given by "
+                    "--shm", {"update"});
+  ARGS_T arg_match(g_progress_options, "PATTERN", "Pick the progress out of lines matching PATTERN and ignore all "
+                   "other lines; %p is a percentage, %d and %t are amounts done and total, %D and %T are times "
+                   "done and total, %e is the time left, %* skips text and `|' separates alternatives; "
+                   "the presets rsync, curl, wget and ffmpeg can be used instead of a pattern", {"match"});
+  args::ImplicitValueFlag<int> arg_log(g_progress_options, "LINES", "Show all lines that don't update the "
+                                       "progress in a pane below the bar, keeping the last LINES lines (default: 1000)",
+                                       {"log"}, 1000, 0);
+  ARG_T  arg_copy(g_progress_options, "copy", "Copy the files given as `SRC... DST' and show the progress; DST "
+                  "must be a directory if there's more than one SRC", {"copy"});
+  args::PositionalList<std::string> arg_copy_files(g_progress_options, "SRC... DST", "Files to copy with --copy");
+  ARGS_T arg_timing(g_progress_options, "FILE|FD", "Write the start, duration and number of updates of every "
+                    "--multi stage and every #comment to FILE or the file descriptor FD as tab separated values "
+                    "when the dialog is closed", {"timing"});
 
   args::Group g_progress_text_info_options(ap_main, "Progress/text information options:");
   ARG_T  arg_auto_close(g_progress_text_info_options, "auto-close", "Automatically close the dialog window",
@@ -229,6 +296,19 @@ int main(int argc, char **argv)
   ARGS_T arg_checkbox(g_text_info_options, "TEXT", "Enable an \"I read and agree\" checkbox", {"checkbox"});
   ARG_T  arg_auto_scroll(g_text_info_options, "auto-scroll", "Always scroll to the bottom of the text",
                          {"auto-scroll"});
+  ARGS_T arg_filename(g_text_info_options, "FILE", "Show FILE instead of STDIN; the file is memory mapped, so "
+                      "the first lines are shown immediately even for very large files", {"filename"});
+  ARGS_T arg_follow(g_text_info_options, "FILE", "Show FILE and the lines appended to it, like `tail -f'; "
+                    "truncated and rotated files are followed too", {"follow"});
+  ARG_T  arg_tee(g_text_info_options, "tee", "Pass STDIN through to STDOUT while showing it; lines are left out "
+                 "of the view rather than slowing down the pipe if the window can't keep up, and the program "
+                 "only exits once all of STDIN was passed through, even if the window was closed", {"tee"});
+  ARGS_T arg_command(g_text_info_options, "COMMAND", "Run COMMAND and show its output, STDERR in red; the "
+                     "exit status of COMMAND is returned", {"command"});
+  ARGL_T arg_max_lines(g_text_info_options, "NUMBER", "Keep only the last NUMBER lines; the oldest lines are "
+                       "dropped, so memory stays bounded when following a log", {"max-lines"});
+  ARGS_T arg_max_bytes(g_text_info_options, "BYTES", "Keep only the last BYTES of text; suffixes K, M, G and T "
+                       "are accepted", {"max-bytes"});
 
   args::Group g_notification_options(ap_main, "Notification options:");
   ARGI_T arg_timeout(g_notification_options, "SECONDS", "Set the timeout value for the notification in seconds",
@@ -276,6 +356,22 @@ int main(int argc, char **argv)
     return 0;
   }
 
+  /* file names are only accepted by --copy */
+  if (arg_copy_files && !(arg_copy && arg_progress)) {
+    std::cerr << argv[0] << ": unexpected argument: " << args::get(arg_copy_files).front()
+      << "\nSee `" << argv[0] << " --help' for more information" << std::endl;
+    return 1;
+  }
+
+  /* update a --shm progress channel; doesn't need a display */
+  if (arg_update) {
+    if (!arg_shm || arg_progress) {
+      std::cerr << argv[0] << ": `--update' requires `--shm' and cannot be used with `--progress'" << std::endl;
+      return 1;
+    }
+    return progress_shm_update(args::get(arg_shm).c_str(), args::get(arg_update).c_str());
+  }
+
   if (arg_message +
       arg_warning +
       arg_question +
@@ -460,8 +556,7 @@ int main(int argc, char **argv)
   }
 
   /* progress */
-  int multi = 1;
-  long kill_pid = -1;
+  progress_options progress;
   if (arg_progress) {
     dialog = DIALOG_PROGRESS;
 
@@ -470,9 +565,119 @@ int main(int argc, char **argv)
       return 1;
     }
 
-    GETVAL(kill_pid, arg_watch_pid);
+    if (arg_pipe && (arg_pulsate || arg_multi)) {
+      std::cerr << argv[0] << ": cannot use `--pipe' together with `--multi' or `--pulsate'" << std::endl;
+      return 1;
+    }
+
+    if (arg_tasks && (arg_pulsate || arg_multi || arg_pipe)) {
+      std::cerr << argv[0] << ": cannot use `--tasks' together with `--multi', `--pulsate' or `--pipe'"
+        << std::endl;
+      return 1;
+    }
+
+    if (arg_monitor_pid && (arg_pulsate || arg_multi || arg_pipe || arg_tasks)) {
+      std::cerr << argv[0] << ": cannot use `--monitor-pid' together with `--multi', `--pulsate', `--pipe' "
+        "or `--tasks'" << std::endl;
+      return 1;
+    }
+
+    if (arg_shm && (arg_pulsate || arg_multi || arg_pipe || arg_tasks || arg_monitor_pid)) {
+      std::cerr << argv[0] << ": cannot use `--shm' together with `--multi', `--pulsate', `--pipe', `--tasks' "
+        "or `--monitor-pid'" << std::endl;
+      return 1;
+    }
+
+    if (arg_match && (arg_pulsate || arg_pipe || arg_tasks || arg_monitor_pid || arg_shm)) {
+      std::cerr << argv[0] << ": cannot use `--match' together with `--pulsate', `--pipe', `--tasks', "
+        "`--monitor-pid' or `--shm'" << std::endl;
+      return 1;
+    }
+
+    if (arg_copy && (arg_pulsate || arg_multi || arg_pipe || arg_tasks || arg_monitor_pid || arg_shm || arg_fd ||
+                     arg_match || arg_log || arg_timing))
+    {
+      std::cerr << argv[0] << ": cannot use `--copy' together with `--multi', `--pulsate', `--pipe', `--tasks', "
+        "`--monitor-pid', `--shm', `--fd', `--match', `--log' or `--timing'" << std::endl;
+      return 1;
+    }
+
+    if (arg_copy && args::get(arg_copy_files).size() < 2) {
+      std::cerr << argv[0] << ": `--copy' requires at least one source and a target" << std::endl;
+      return 1;
+    }
+
+    if (arg_log && (arg_pipe || arg_tasks || arg_monitor_pid || arg_shm || arg_fd)) {
+      std::cerr << argv[0] << ": cannot use `--log' together with `--pipe', `--tasks', `--monitor-pid', "
+        "`--shm' or `--fd'" << std::endl;
+      return 1;
+    }
+
+    if (arg_timing && (arg_pipe || arg_tasks || arg_monitor_pid || arg_shm || arg_fd)) {
+      std::cerr << argv[0] << ": cannot use `--timing' together with `--pipe', `--tasks', `--monitor-pid', "
+        "`--shm' or `--fd'" << std::endl;
+      return 1;
+    }
+
+    if (arg_fd && !arg_monitor_pid && (arg_pulsate || arg_multi || arg_pipe || arg_tasks || arg_shm || arg_match)) {
+      std::cerr << argv[0] << ": cannot use `--fd' without `--monitor-pid' together with `--multi', `--pulsate', "
+        "`--pipe', `--tasks', `--shm' or `--match'" << std::endl;
+      return 1;
+    }
+
+    progress.pulsate = arg_pulsate;
+    progress.autoclose = arg_auto_close;
+    progress.hide_cancel = arg_no_cancel;
+    progress.stats = arg_stats;
+    progress.pipe = arg_pipe;
+    progress.tasks = arg_tasks;
+
+    GETVAL(progress.monitor_pid, arg_monitor_pid);
+    GETVAL(progress.fds, arg_fd);
+    GETCSTR(progress.shm, arg_shm);
+    GETCSTR(progress.timing, arg_timing);
+
+    if (arg_copy) {
+      progress.copy = args::get(arg_copy_files);
+    }
+
+    if (arg_log) {
+      if (args::get(arg_log) < 1) {
+        std::cerr << argv[0] << ": error `--log': value must be greater than zero" << std::endl;
+        return 1;
+      }
+      progress.log = args::get(arg_log);
+    }
+
+    GETVAL(progress.watch_pids, arg_watch_pid);
+
+    int multi = 1;
     GETVAL(multi, arg_multi);
-    multi = (multi > 1) ? multi : 1;
+    progress.multi = (multi > 1) ? multi : 1;
+
+    GETVAL(progress.fps, arg_fps);
+    if (progress.fps <= 0) {
+      std::cerr << argv[0] << ": error `--fps': value must be greater than zero" << std::endl;
+      return 1;
+    }
+
+    if (arg_match) {
+      line_matcher lm;
+      std::string error;
+
+      if (!(progress.match = line_matcher::preset(args::get(arg_match).c_str()))) {
+        progress.match = args::get(arg_match).c_str();
+      }
+
+      if (!lm.compile(progress.match, error)) {
+        std::cerr << argv[0] << ": error `--match': " << error << std::endl;
+        return 1;
+      }
+    }
+
+    if (arg_size && _argtosize(args::get(arg_size).c_str(), progress.size, argv[0], "--size")) {
+      return 1;
+    }
   }
 
   /* scale */
@@ -524,15 +729,51 @@ int main(int argc, char **argv)
   }
 
   /* text-info */
-  const char *checkbox = NULL;
+  textinfo_options textinfo;
   if (arg_text_info) {
     dialog = DIALOG_TEXTINFO;
-    GETCSTR(checkbox, arg_checkbox);
 
     if (arg_checkbox && arg_auto_close) {
       std::cerr << argv[0] << ": cannot use `--checkbox' and `--auto-close' together" << std::endl;
       return 1;
     }
+
+    if (arg_filename && arg_follow) {
+      std::cerr << argv[0] << ": cannot use `--filename' and `--follow' together" << std::endl;
+      return 1;
+    }
+
+    if (arg_tee && (arg_filename || arg_follow)) {
+      std::cerr << argv[0] << ": cannot use `--tee' together with `--filename' or `--follow'" << std::endl;
+      return 1;
+    }
+
+    if (arg_command && (arg_filename || arg_follow || arg_tee)) {
+      std::cerr << argv[0] << ": cannot use `--command' together with `--filename', `--follow' or `--tee'"
+        << std::endl;
+      return 1;
+    }
+
+    textinfo.autoscroll = arg_auto_scroll;
+    textinfo.autoclose = arg_auto_close;
+    textinfo.hide_cancel = arg_no_cancel;
+    textinfo.tee = arg_tee;
+    GETCSTR(textinfo.checkbox, arg_checkbox);
+    GETCSTR(textinfo.filename, arg_filename);
+    GETCSTR(textinfo.follow, arg_follow);
+    GETCSTR(textinfo.command, arg_command);
+
+    if (arg_max_lines) {
+      if (args::get(arg_max_lines) < 1) {
+        std::cerr << argv[0] << ": error `--max-lines': value must be greater than zero" << std::endl;
+        return 1;
+      }
+      textinfo.max_lines = args::get(arg_max_lines);
+    }
+
+    if (arg_max_bytes && _argtosize(args::get(arg_max_bytes).c_str(), textinfo.max_bytes, argv[0], "--max-bytes")) {
+      return 1;
+    }
   }
 
   /* keep fltk's '@' symbols enabled for HTML, date and calendar dialogs */
@@ -603,9 +844,9 @@ int main(int argc, char **argv)
     case DIALOG_NOTIFY:
       return dialog_notify(argv[0], timeout, icon, arg_libnotify);
     case DIALOG_PROGRESS:
-      return dialog_progress(arg_pulsate, multi, kill_pid, arg_auto_close, arg_no_cancel);
+      return dialog_progress(progress);
     case DIALOG_TEXTINFO:
-      return dialog_textinfo(arg_auto_scroll, checkbox, arg_auto_close, arg_no_cancel);
+      return dialog_textinfo(textinfo);
     case DIALOG_CHECKLIST:
       return dialog_checklist(checklist_options, arg_return_value, arg_check_all, separator);
     case DIALOG_RADIOLIST:
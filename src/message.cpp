@@ -63,7 +63,8 @@ static void callback(Fl_Widget *o, void *p)
     b->copy_label(ss2.str().c_str());
   }
 
-  Fl::redraw();
+  /* the slider redraws itself, only the value box needs an update */
+  b->redraw();
 }
 
 int dialog_message(int type
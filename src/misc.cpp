@@ -342,6 +342,16 @@ int leap_year(int y)
   return 0;
 }
 
+/* returns the time of a monotonic clock in seconds,
+ * useful to measure time intervals
+ */
+double monotonic_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 #if defined(HAVE_QT) && defined(USE_DLOPEN)
 void *dlopen_qtplugin(std::string &plugin, void * &handle, const char *func)
 {
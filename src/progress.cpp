@@ -24,7 +24,17 @@
 
 // Tests:
 // (echo 40; sleep 1; echo 80; sleep 1; echo 99; sleep 1; echo '#Done' && echo '100') | ./fltk-dialog --progress
+// (for i in $(seq 1 90210); do echo "$i/90210"; done) | ./fltk-dialog --progress
 // (echo '#Work in progress... ' && sleep 4 && echo '#Work in progress... done.' && echo 'STOP') | ./fltk-dialog --progress --pulsate
+// head -c 2G /dev/zero | ./fltk-dialog --progress --pipe --size=2G | md5sum
+// (for i in $(seq 0 99); do echo "$i:#task $i"; done; for p in 25 50 75 100; do for i in $(seq 0 99); do echo "$i:$p"; done; sleep 1; done) | ./fltk-dialog --progress --tasks
+// cp big.iso /mnt/usb/ & ./fltk-dialog --progress --monitor-pid=$! --auto-close
+// rsync -a --info=progress2 src/ dst/ | ./fltk-dialog --progress --match=rsync
+// ./fltk-dialog --progress --fd=3 --fd=4 3< <(for i in $(seq 1 100); do echo $i; sleep 0.02; done) 4< <(for i in $(seq 1 100); do echo $i; sleep 0.05; done)
+// (echo '#download'; echo 50; sleep 1; echo 100; echo '#install'; sleep 2; echo 100) | ./fltk-dialog --progress --multi=2 --timing=/dev/stderr
+// (for i in $(seq 1 100); do echo "step $i"; echo $i; sleep 0.05; done) | ./fltk-dialog --progress --log=50
+// ./fltk-dialog --progress --copy big.iso other.iso /mnt/usb/
+// ./fltk-dialog --progress --shm=job & sleep 1; for i in $(seq 1 100); do ./fltk-dialog --shm=job --update=$i; sleep 0.05; done
 
 /*
 (echo '#1/3'; echo 40; sleep 1; echo 80; sleep 1; echo 100; sleep 1; \
@@ -36,229 +46,1940 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <errno.h>
+#include <math.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <libgen.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "fltk-dialog.hpp"
+#include "line_matcher.hpp"
+#include "log_view.hpp"
+#include "progress_shm.h"
+#include "rate_estimator.hpp"
+#include "task_list.hpp"
 
 #define DEFAULT_SLIDER_SIZE 0.2
 
+/* distance (in bar widths) the pulsating slider travels per second */
+#define PULSATE_SPEED 0.8
+
+/* how often the file position of --monitor-pid is sampled */
+#define MONITOR_INTERVAL 0.5
+
+/* --copy: bytes copied per system call; also the granularity of cancelling */
+#define COPY_CHUNK (8*1024*1024)
+
+/* --log: longer lines are cut off */
+#define LOG_LINE_MAX 1024
+
+/* how often processes are polled if pidfd_open() isn't available */
+#define PID_POLL_INTERVAL 0.5
+
+#ifndef SYS_pidfd_open
+# define SYS_pidfd_open 434
+#endif
+#ifndef P_PIDFD
+# define P_PIDFD 3
+#endif
+
 class loop_bar : public Fl_Widget
 {
   /* values between 0.0 and 1.0 */
   double slider_size_, value_;
 
-  void draw();
+  void draw();
+
+public:
+  loop_bar(int X, int Y, int W, int H);
+
+  double slider_size() const { return slider_size_; }
+  void slider_size(double v) {
+    slider_size_ = (v > 0.0 && v < 1.0) ? v : DEFAULT_SLIDER_SIZE;
+  }
+
+  double value() const { return value_; }
+  void value(double v) { value_ = v; }
+};
+
+static loop_bar         *lp = NULL;
+static Fl_Double_Window *win = NULL;
+static Fl_Box           *box = NULL;
+static Fl_Return_Button *but_ok = NULL;
+static Fl_Button        *but_cancel = NULL;
+static Fl_Progress      *bar = NULL, *bar_main = NULL;
+static task_list        *tasks = NULL;
+static log_view         *log_pane = NULL;
+static int ret = 1;
+static pthread_t t;
+static bool have_thread = false;
+static double frame_interval = 1.0/60, last_frame = 0, last_apply = 0;
+
+/* owned by the input thread */
+static double percent = 0, multi_percent = 0, chunk_time = 0;
+static unsigned int multi = 1, iteration = 0;
+static bool running = true;
+static rate_estimator est_bar, est_main;
+
+/* Newest state parsed by the input thread; the main loop picks it up at
+ * most once per frame, everything in between is collapsed. */
+struct progress_state {
+  double bar_value, main_value;  /* percent */
+  double done, total;            /* "done/total" input, total is 0 if not used */
+  double rate, eta, main_eta;    /* units per second, seconds left */
+  unsigned long long bytes;
+  bool value_changed, comment_changed, finished;
+  unsigned long lines, pending;
+};
+
+static progress_state in = { 0, 0, 0, 0, 0, -1, -1, 0, false, false, false, 0, 0 };
+static std::string in_comment;
+
+/* --tasks: all tasks in order of their first mention, changed tasks are
+ * queued once per frame */
+struct task_state {
+  size_t index;
+  long id;
+  double value;
+  std::string label;
+  bool dirty;
+};
+
+static std::vector<task_state> in_tasks, frame_tasks;
+static std::unordered_map<long, size_t> task_index;
+static std::vector<size_t> dirty_tasks;
+static double tasks_sum = 0;
+
+static pthread_mutex_t in_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool frame_pending = false;
+static unsigned long frames = 0, collapsed = 0;
+
+/* --stats: area of all redraw requests in pixels */
+static unsigned long long redraw_area = 0;
+static double start_time = 0;
+
+/* expected number of bytes of --pipe or --monitor-pid, 0 if unknown */
+static unsigned long long transfer_size = 0;
+
+/* --shm */
+static struct fltk_dialog_shm *shm = NULL;
+static std::string shm_path;
+static uint64_t shm_progress_ticket = 0, shm_text_ticket = 0;
+
+/* --monitor-pid */
+static long monitor_pid = -1;
+static int monitor_fd = -1;
+static bool monitor_auto = false;
+
+static bool done = false
+,           pipe_mode = false
+,           copy_mode = false
+,           tasks_mode = false
+,           pulsate = false
+,           autoclose = false
+,           hide_cancel = false;
+
+/* --watch-pid */
+struct watched_pid {
+  long pid;
+  int fd;  /* pidfd, or -1 if the process is polled */
+  bool running;
+};
+
+static std::vector<watched_pid> watched;
+static int pid_status = 0;
+
+/* --fd without --monitor-pid: input descriptors served by the main loop;
+ * `input_id' is the descriptor whose lines are currently parsed */
+struct input_fd {
+  int fd;
+  std::string rest;
+};
+
+static std::vector<input_fd> input_fds;
+static size_t open_inputs = 0;
+static long input_id = -1;
+
+/* --timing: one entry per --multi stage and per "#comment";
+ * appended by the input thread with in_mutex locked */
+struct timing_entry {
+  unsigned int stage;
+  double start;
+  unsigned long updates;
+  std::string name;
+};
+
+static std::vector<timing_entry> timing;
+static bool timing_mode = false;
+static double timing_end = -1;  /* time the input has finished */
+
+/* --log: lines received since the last frame, a ring of the same capacity
+ * as the log pane; the strings are swapped back and forth between both
+ * rings, so a full log doesn't allocate anymore */
+static std::vector<std::string> in_log;
+static size_t in_log_first = 0, in_log_count = 0;
+
+/* --copy; `copy_cancelled' and `copy_error' are guarded by in_mutex */
+struct copy_job {
+  std::string src, dst;
+  unsigned long long size;
+};
+
+static std::vector<copy_job> copy_jobs;
+static unsigned long long copy_file_done = 0;
+static bool copy_cancelled = false;
+static std::string copy_error, copy_name;
+
+/* --pipe; `pipe_error' is guarded by in_mutex */
+static std::string pipe_error;
+
+/* --match; `matched' keeps the values of earlier lines */
+static line_matcher matcher;
+static line_match matched = { 0, 0, 0, 0, 0 };
+
+void loop_bar::draw()
+{
+  int dx, dy, dw, dh, sw, bx1, bx2, by, bh;
+  double max;
+
+  /* box borders */
+  dx = Fl::box_dx(box());
+  dy = Fl::box_dy(box());
+  dw = Fl::box_dw(box());
+  dh = Fl::box_dh(box());
+
+  /* main box */
+  fl_push_clip(x(), y(), w(), h());
+  draw_box(box(), x(), y(), w(), h(), active_r() ? color() : fl_inactive(color()));
+  fl_pop_clip();
+
+  /* slider */
+  if (value() > 0.0 && value() < 1.0) {
+    sw = slider_size() * w();
+    max = w() + sw;
+    bx1 = x() + dx;
+    bx2 = bx1 + (value() * max) - sw;
+    by = y() + dy;
+    bh = h() - dh;
+
+    fl_push_clip(bx1, by, w() - dw, bh);
+    draw_box(FL_FLAT_BOX, bx2, by, sw - dw, bh, active_r() ? selection_color() : fl_inactive(selection_color()));
+    fl_pop_clip();
+  }
+}
+
+loop_bar::loop_bar(int X, int Y, int W, int H)
+ : Fl_Widget(X, Y, W, H)
+{
+  box(FL_DOWN_BOX);
+  color(fl_darker(color()));
+  selection_color(fl_lighter(FL_BLUE));
+  value(0.0);
+  slider_size(DEFAULT_SLIDER_SIZE);
+}
+
+/* Only the widgets that have changed get redrawn, never the whole window;
+ * with a double buffered window over a remote X connection this is the
+ * difference between copying the bar and copying the dialog. */
+static void redraw_widget(Fl_Widget *w)
+{
+  w->redraw();
+  redraw_area += w->w() * w->h();
+}
+
+/* The status text is drawn right of its FL_NO_BOX box, so the window
+ * area up to the right border is damaged; this covers a longer old text
+ * too, unlike redraw_label() which only measures the new one. */
+static void redraw_status(void)
+{
+  int X = box->x(), Y = box->y(), W = win->w() - box->x(), H = box->h();
+
+  win->damage(FL_DAMAGE_ALL, X, Y, W, H);
+  redraw_area += W * H;
+}
+
+/* skips the redraw if neither value nor label have changed */
+static void set_bar(Fl_Progress *b, double value, const char *label)
+{
+  if (b->value() == static_cast<float>(value) && b->label() && strcmp(b->label(), label) == 0) {
+    return;
+  }
+  b->value(value);
+  b->copy_label(label);
+  redraw_widget(b);
+}
+
+static void pulsate_cb(void *);
+static void frame_cb(void *);
+static void poll_pids_cb(void *);
+static void monitor_cb(void *);
+static void shm_cb(void *);
+
+static void close_cb(Fl_Widget *, long p) {
+  if (copy_mode) {
+    /* the copy thread stops after the current chunk and removes the
+     * partial file; it's joined once the main loop has returned */
+    pthread_mutex_lock(&in_mutex);
+    copy_cancelled = true;
+    pthread_mutex_unlock(&in_mutex);
+  } else if (have_thread) {
+    pthread_cancel(t);
+  }
+  Fl::remove_timeout(pulsate_cb);
+  Fl::remove_timeout(frame_cb);
+  Fl::remove_timeout(poll_pids_cb);
+  Fl::remove_timeout(monitor_cb);
+  Fl::remove_timeout(shm_cb);
+  for (size_t i = 0; i < input_fds.size(); ++i) {
+    if (input_fds[i].fd != -1) {
+      Fl::remove_fd(input_fds[i].fd);
+    }
+  }
+  win->hide();
+  ret = p;
+}
+
+static void cancel_cb(Fl_Widget *o)
+{
+  /* only processes started after the dialog, like the other commands of
+   * a pipeline it is part of; --watch-pid otherwise just observes */
+  for (size_t i = 0; i < watched.size(); ++i) {
+    if (watched[i].running && watched[i].pid > getpid()) {
+      kill(watched[i].pid, SIGHUP);
+    }
+  }
+  close_cb(o, 1);
+}
+
+static void progress_finished(void)
+{
+  if (done) {
+    return;
+  }
+  done = true;
+
+  if (autoclose) {
+    close_cb(NULL, 0);
+  } else {
+    if (!hide_cancel) {
+      but_cancel->deactivate();
+    }
+    but_ok->activate();
+  }
+
+  if (pulsate) {
+    lp->value(0.0);
+    lp->deactivate();
+    redraw_widget(lp);
+  }
+}
+
+/* Reads /proc/PID/stat into `buf' and returns a pointer to the closing
+ * parenthesis of the command name in field 2, which may contain spaces;
+ * the fields after it are simply separated by one space each.
+ * Returns NULL if the process is gone. */
+static const char *read_proc_stat(long pid, char *buf, size_t size)
+{
+  char path[64];
+  ssize_t n;
+  int fd;
+
+  snprintf(path, sizeof(path) - 1, "/proc/%ld/stat", pid);
+
+  if ((fd = open(path, O_RDONLY|O_CLOEXEC)) == -1) {
+    return NULL;
+  }
+  n = read(fd, buf, size - 1);
+  close(fd);
+
+  if (n <= 0) {
+    return NULL;
+  }
+  buf[n] = '\0';
+
+  return strrchr(buf, ')');
+}
+
+/* Returns the exit status of a process that has terminated, shell style
+ * (128+n if killed by signal n), or -1 if it can't be obtained.
+ * waitid() only works on our own children, for other processes the
+ * exit_code field of /proc/PID/stat is used, which is readable until
+ * the parent has reaped the process. */
+static int get_exit_status(const watched_pid &w)
+{
+  siginfo_t si;
+  char buf[1024];
+  const char *p;
+  int field, code;
+
+  memset(&si, 0, sizeof(si));
+
+  if (w.fd != -1 && waitid(static_cast<idtype_t>(P_PIDFD), w.fd, &si, WEXITED|WNOHANG) == 0 && si.si_pid != 0) {
+    return (si.si_code == CLD_EXITED) ? si.si_status : 128 + si.si_status;
+  }
+
+  if ((p = read_proc_stat(w.pid, buf, sizeof(buf))) == NULL) {
+    return -1;
+  }
+
+  /* exit_code is field 52 */
+  for (field = 2; *p && field < 52; ++p) {
+    if (*p == ' ') {
+      field++;
+    }
+  }
+  if (field != 52 || sscanf(p, "%d", &code) != 1) {
+    return -1;
+  }
+
+  if (WIFEXITED(code)) {
+    return WEXITSTATUS(code);
+  }
+  return WIFSIGNALED(code) ? 128 + WTERMSIG(code) : -1;
+}
+
+static void pid_exited(watched_pid &w)
+{
+  int status = get_exit_status(w);
+
+  if (w.fd != -1) {
+    Fl::remove_fd(w.fd);
+    close(w.fd);
+    w.fd = -1;
+  }
+  w.running = false;
+
+  /* report the first failure */
+  if (pid_status == 0 && status > 0) {
+    pid_status = status;
+  }
+
+  for (size_t i = 0; i < watched.size(); ++i) {
+    if (watched[i].running) {
+      return;
+    }
+  }
+
+  /* all watched processes have stopped */
+  progress_finished();
+}
+
+static void pidfd_cb(int, void *v) {
+  pid_exited(watched[reinterpret_cast<intptr_t>(v)]);
+}
+
+/* true once the process has terminated; kill(pid, 0) still succeeds
+ * for a zombie whose parent didn't reap it yet, so the state in field 3
+ * of /proc/PID/stat is checked as well */
+static bool pid_terminated(long pid)
+{
+  char buf[1024];
+  const char *p;
+
+  if (kill(pid, 0) == -1 && errno == ESRCH) {
+    return true;
+  }
+  if ((p = read_proc_stat(pid, buf, sizeof(buf))) == NULL) {
+    return false;
+  }
+  return (p[1] == ' ' && (p[2] == 'Z' || p[2] == 'X'));
+}
+
+/* fallback for kernels without pidfd_open() */
+static void poll_pids_cb(void *)
+{
+  bool polling = false;
+
+  for (size_t i = 0; i < watched.size(); ++i) {
+    watched_pid &w = watched[i];
+
+    if (w.running && w.fd == -1) {
+      if (pid_terminated(w.pid)) {
+        pid_exited(w);
+      } else {
+        polling = true;
+      }
+    }
+  }
+
+  if (polling) {
+    Fl::repeat_timeout(PID_POLL_INTERVAL, poll_pids_cb);
+  }
+}
+
+/* A pidfd becomes readable when the process terminates, so it is simply
+ * added to the main loop and no polling is needed. */
+static void watch_pids(const std::vector<long> &pids)
+{
+  bool polling = false;
+
+  watched.clear();
+
+  for (size_t i = 0; i < pids.size(); ++i) {
+    watched_pid w = { pids[i], -1, true };
+
+    if (w.pid <= 0 || w.pid == getpid()) {
+      continue;
+    }
+    w.fd = syscall(SYS_pidfd_open, w.pid, 0);
+
+    if (w.fd == -1 && errno == ESRCH) {
+      continue;  /* already gone */
+    }
+    watched.push_back(w);
+  }
+
+  if (watched.empty()) {
+    if (!pids.empty()) {
+      progress_finished();
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < watched.size(); ++i) {
+    if (watched[i].fd == -1) {
+      polling = true;
+    } else {
+      Fl::add_fd(watched[i].fd, FL_READ, pidfd_cb, reinterpret_cast<void *>(static_cast<intptr_t>(i)));
+    }
+  }
+
+  if (polling) {
+    Fl::add_timeout(PID_POLL_INTERVAL, poll_pids_cb);
+  }
+}
+
+/* "42", "42.7" or "done/total"; total is set to 0 if not used */
+static double parse_percent(const char *ch, double &done, double &total)
+{
+  char *p;
+  double value = strtod(ch, &p);
+
+  if (*p == '/' && (total = strtod(p + 1, NULL)) > 0) {
+    done = value;
+    return value * 100 / total;
+  }
+
+  total = 0;
+  return value;
+}
+
+/* returns the task with the given ID, a new task is appended to the list */
+static task_state &find_task(long id)
+{
+  std::unordered_map<long, size_t>::iterator it;
+
+  if ((it = task_index.find(id)) != task_index.end()) {
+    return in_tasks[it->second];
+  }
+
+  task_state ts = { in_tasks.size(), id, 0, "", false };
+  task_index[id] = ts.index;
+  in_tasks.push_back(ts);
+
+  return in_tasks.back();
+}
+
+/* "45", "1834/90210" or "#copying shard" for the task `id';
+ * called with in_mutex locked */
+static void parse_task(long id, const char *p)
+{
+  task_state &ts = find_task(id);
+  size_t index = ts.index;
+  double value, done, total;
+
+  if (*p == '#') {
+    ts.label = p + 1;
+  } else if (*p >= '0' && *p <= '9') {
+    value = parse_percent(p, done, total);
+    value = (value > 100) ? 100 : value;
+    tasks_sum += value - ts.value;
+    ts.value = value;
+  }
+
+  if (!ts.dirty) {
+    ts.dirty = true;
+    dirty_tasks.push_back(index);
+  }
+
+  /* the main bar shows the average of all tasks */
+  percent = tasks_sum / in_tasks.size();
+  in.bar_value = percent;
+  est_bar.add(chunk_time, percent);
+  in.rate = est_bar.rate();
+  in.eta = est_bar.eta(percent, 100);
+  in.value_changed = true;
+}
+
+/* "17:45", "17:1834/90210" or "17:#copying shard";
+ * called by the input thread with in_mutex locked */
+static void parse_task_line(const char *ch)
+{
+  char *p;
+  long id = strtol(ch, &p, 10);
+
+  if (p != ch && *p == ':') {
+    parse_task(id, p + 1);
+  }
+}
+
+/* --log: queues a line for the log pane;
+ * called by the input thread with in_mutex locked */
+static void log_line(const char *ch)
+{
+  size_t len = strlen(ch);
+
+  if (in_log_count == in_log.size()) {
+    /* more lines than the pane can show since the last frame */
+    in_log_first = (in_log_first + 1) % in_log.size();
+    in_log_count--;
+  }
+
+  in_log[(in_log_first + in_log_count) % in_log.size()].assign(ch, (len > LOG_LINE_MAX) ? LOG_LINE_MAX : len);
+  in_log_count++;
+}
+
+static void timing_begin(double time, const std::string &name)
+{
+  timing_entry e = { iteration + 1, time, 0, name };
+  timing.push_back(e);
+}
+
+/* a comment right after a stage transition names the new stage
+ * instead of adding an empty entry */
+static void timing_label(const std::string &name)
+{
+  timing_entry &e = timing.back();
+
+  if (e.updates == 0 && e.stage == iteration + 1) {
+    e.name = name;
+  } else {
+    timing_begin(chunk_time, name);
+  }
+}
+
+/* Sets the bar to `value' percent and advances --multi; a negative
+ * `seconds_left' means the time left is estimated.
+ * Called by the input thread with in_mutex locked. */
+static void set_percent(double value, double seconds_left)
+{
+  unsigned int stage = iteration;
+
+  percent = value;
+
+  if (timing_mode) {
+    timing.back().updates++;
+  }
+
+  if (percent >= 100) {
+    percent = 100;
+    running = multi > 1;
+    iteration++;
+  }
+  in.bar_value = percent;
+
+  est_bar.add(chunk_time, percent);
+  in.rate = est_bar.rate();
+  in.eta = (seconds_left >= 0) ? seconds_left : est_bar.eta(percent, 100);
+
+  /* update the main progress bar too if --multi=n was given */
+  if (multi > 1) {
+    if (percent == 100) {
+      /* reset % for next iteration */
+      percent = 0;
+    }
+    multi_percent = iteration * 100 + percent;
+    if (multi_percent >= multi * 100) {
+      multi_percent = multi * 100;
+      running = false;
+    }
+    in.main_value = multi_percent;
+
+    est_main.add(chunk_time, multi_percent);
+    in.main_eta = est_main.eta(multi_percent, multi * 100);
+  }
+  in.value_changed = true;
+
+  if (timing_mode && running && iteration != stage) {
+    timing_begin(chunk_time, timing.back().name);
+  }
+}
+
+/* --match: picks the progress out of any line that matches the pattern,
+ * returns false if it didn't match */
+static bool parse_matched_line(const char *ch)
+{
+  if (!matcher.match(ch, strlen(ch), matched)) {
+    return false;
+  }
+
+  if (matched.found & line_match::PERCENT) {
+    set_percent(matched.percent, (matched.found & line_match::ETA) ? matched.eta : -1);
+  } else if ((matched.found & (line_match::DONE|line_match::TOTAL)) && matched.total > 0) {
+    /* a total given on an earlier line is kept, i.e. ffmpeg's "Duration:" */
+    set_percent(matched.done * 100 / matched.total, (matched.found & line_match::ETA) ? matched.eta : -1);
+  }
+  return true;
+}
+
+/* called by the input thread with in_mutex locked */
+static void parse_line(const char *ch)
+{
+  if (!running) {
+    return;
+  }
+
+  in.lines++;
+  in.pending++;
+
+  if (input_id != -1) {
+    /* --fd: every descriptor feeds its own task, comments included */
+    parse_task(input_id, ch);
+  } else if (ch[0] == '#' && ch[1] != '\0') {
+    /* "#comment" line found, change the label */
+    in_comment = ch + 1;
+    in.comment_changed = true;
+
+    if (timing_mode) {
+      timing_label(in_comment);
+    }
+  } else if (tasks_mode) {
+    parse_task_line(ch);
+  } else if (!matcher.empty()) {
+    if (!parse_matched_line(ch) && !in_log.empty()) {
+      log_line(ch);
+    }
+  } else if (!pulsate && ch[0] >= '0' && ch[0] <= '9') {
+    /* number found, update the progress bar;
+     * accepted are "42", "42.7" and "done/total" */
+    set_percent(parse_percent(ch, in.done, in.total), -1);
+  } else if (pulsate && strcmp(ch, "STOP") == 0) {
+    /* stop now */
+    running = false;
+  } else if (!in_log.empty()) {
+    log_line(ch);
+  }
+
+  if (!running) {
+    in.finished = true;
+
+    if (timing_mode && timing_end < 0) {
+      timing_end = chunk_time;
+    }
+  }
+}
+
+static void format_bytes(char *buf, size_t size, double bytes)
+{
+  const char *units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+  int i = 0;
+
+  for ( ; bytes >= 1024 && i < 4; ++i) {
+    bytes /= 1024;
+  }
+
+  if (i == 0) {
+    snprintf(buf, size - 1, "%d %s", static_cast<int>(bytes), units[i]);
+  } else {
+    snprintf(buf, size - 1, "%.1f %s", bytes, units[i]);
+  }
+}
+
+static void format_time(char *buf, size_t size, double seconds)
+{
+  unsigned long s = seconds;
+
+  if (s >= 3600) {
+    snprintf(buf, size - 1, "%lu:%02lu:%02lu", s / 3600, (s / 60) % 60, s % 60);
+  } else {
+    snprintf(buf, size - 1, "%lu:%02lu", s / 60, s % 60);
+  }
+}
+
+/* "1.2 GiB of 4.0 GiB, 350.0 MiB/s, 0:08 left" */
+static void update_transfer_label(unsigned long long bytes, double bps, double seconds_left)
+{
+  char l[160] = {0}, b[32] = {0}, total[32] = {0}, rate[32] = {0}, eta[32] = {0};
+
+  format_bytes(b, sizeof(b), bytes);
+  format_bytes(rate, sizeof(rate), bps);
+
+  if (transfer_size > 0) {
+    format_bytes(total, sizeof(total), transfer_size);
+
+    if (seconds_left >= 0) {
+      format_time(eta, sizeof(eta), seconds_left);
+      snprintf(l, sizeof(l) - 1, "%s of %s, %s/s, %s left", b, total, rate, eta);
+    } else {
+      snprintf(l, sizeof(l) - 1, "%s of %s, %s/s", b, total, rate);
+    }
+  } else {
+    snprintf(l, sizeof(l) - 1, "%s, %s/s", b, rate);
+  }
+
+  box->copy_label(l);
+  redraw_status();
+}
+
+/* "42%", "42.7%, 0:31 left", "1834/90210 (2%), 120.5/s, 12:31 left" */
+static void format_bar_label(char *buf, size_t size, double value, double done, double total,
+                             double rate, double seconds_left)
+{
+  char pct[16] = {0}, eta[32] = {0};
+  int n;
+
+  if (value == floor(value)) {
+    snprintf(pct, sizeof(pct) - 1, "%d%%", static_cast<int>(value));
+  } else {
+    snprintf(pct, sizeof(pct) - 1, "%.1f%%", value);
+  }
+
+  if (total > 0) {
+    n = snprintf(buf, size - 1, "%.15g/%.15g (%s)", done, total, pct);
+    if (rate > 0) {
+      n += snprintf(buf + n, size - 1 - n, ", %.1f/s", rate * total / 100);
+    }
+  } else {
+    n = snprintf(buf, size - 1, "%s", pct);
+  }
+
+  if (seconds_left >= 0 && n > 0 && static_cast<size_t>(n) < size - 1) {
+    format_time(eta, sizeof(eta), seconds_left);
+    snprintf(buf + n, size - 1 - n, ", %s left", eta);
+  }
+}
+
+/* Applies the newest input state to the widgets; called on the main loop
+ * no more often than once per frame. */
+static void frame_cb(void *)
+{
+  progress_state st;
+  std::string comment;
+  char buf[96] = {0};
+  size_t log_lines;
+
+  pthread_mutex_lock(&in_mutex);
+  st = in;
+  if (in.comment_changed) {
+    comment.swap(in_comment);
+  }
+  if (in.pending > 0) {
+    collapsed += in.pending - 1;
+  }
+  in.value_changed = in.comment_changed = false;
+  in.pending = 0;
+  frame_pending = false;
+
+  frame_tasks.clear();
+  for (size_t i = 0; i < dirty_tasks.size(); ++i) {
+    task_state &ts = in_tasks[dirty_tasks[i]];
+    frame_tasks.push_back(ts);
+    ts.dirty = false;
+  }
+  dirty_tasks.clear();
+  log_lines = in_log_count;
+  for ( ; in_log_count > 0; --in_log_count) {
+    log_pane->add(in_log[in_log_first]);
+    in_log_first = (in_log_first + 1) % in_log.size();
+  }
+  pthread_mutex_unlock(&in_mutex);
+
+  frames++;
+  last_apply = monotonic_seconds();
+
+  if (done) {
+    return;
+  }
+
+  if (st.comment_changed) {
+    if (copy_mode) {
+      /* name of the file that is being copied */
+      copy_name.swap(comment);
+    } else {
+      box->copy_label(comment.c_str());
+      redraw_status();
+    }
+  }
+
+  if (log_lines > 0) {
+    redraw_widget(log_pane);
+  }
+
+  if (tasks_mode) {
+    bool visible = false;
+    for (size_t i = 0; i < frame_tasks.size(); ++i) {
+      const task_state &ts = frame_tasks[i];
+      visible |= tasks->set(ts.index, ts.id, ts.value, ts.label);
+    }
+    if (visible) {
+      redraw_widget(tasks);
+    }
+  }
+
+  if (copy_mode) {
+    /* the status shows the total, the bar the current file */
+    if (st.finished && !copy_error.empty()) {
+      box->copy_label(copy_error.c_str());
+      redraw_status();
+    } else {
+      update_transfer_label(st.bytes, st.rate, st.eta);
+    }
+
+    snprintf(buf, sizeof(buf) - 1, "%s: %d%%", copy_name.c_str(), static_cast<int>(st.bar_value));
+    set_bar(bar, st.bar_value, buf);
+
+    if (multi > 1) {
+      snprintf(buf, sizeof(buf) - 1, "%d%%", static_cast<int>(st.main_value / multi));
+      set_bar(bar_main, st.main_value, buf);
+    }
+  } else if (pipe_mode) {
+    if (st.finished && !pipe_error.empty()) {
+      box->copy_label(pipe_error.c_str());
+      redraw_status();
+    } else {
+      update_transfer_label(st.bytes, st.rate, st.eta);
+    }
+
+    if (transfer_size > 0) {
+      snprintf(buf, sizeof(buf) - 1, "%d%%", static_cast<int>(st.bar_value));
+      set_bar(bar, st.bar_value, buf);
+    }
+  } else if (st.value_changed) {
+    format_bar_label(buf, sizeof(buf), st.bar_value, st.done, st.total, st.rate, st.eta);
+    set_bar(bar, st.bar_value, buf);
+
+    if (multi > 1) {
+      format_bar_label(buf, sizeof(buf), st.main_value / multi, 0, 0, 0, st.main_eta);
+      set_bar(bar_main, st.main_value, buf);
+    }
+  }
+
+  if (st.finished) {
+    progress_finished();
+  }
+}
+
+/* woken up by the input thread; keeps the update rate at the frame rate */
+static void schedule_frame_cb(void *)
+{
+  double delay = last_apply + frame_interval - monotonic_seconds();
+  Fl::add_timeout((delay > 0) ? delay : 0, frame_cb);
+}
+
+/* called with in_mutex locked; returns true if the main loop must be woken up */
+static bool request_frame(void)
+{
+  if ((in.pending > 0 || in.finished) && !frame_pending) {
+    frame_pending = true;
+    return true;
+  }
+  return false;
+}
+
+/* With --match a carriage return ends a line too, because tools like
+ * rsync and curl redraw their progress line with "\r". */
+static const char *find_eol(const char *p, const char *end)
+{
+  if (matcher.empty()) {
+    return reinterpret_cast<const char *>(memchr(p, '\n', end - p));
+  }
+
+  for ( ; p < end; ++p) {
+    if (*p == '\n' || *p == '\r') {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+/* Parses all complete lines of a chunk at once, so the mutex is taken
+ * and the main loop is woken up once per read() instead of once per line. */
+static void parse_chunk(const char *buf, size_t len, std::string &rest)
+{
+  const char *end = buf + len;
+  bool wake;
+
+  pthread_mutex_lock(&in_mutex);
+  chunk_time = monotonic_seconds();
+
+  while (buf < end) {
+    const char *nl = find_eol(buf, end);
+
+    if (!nl) {
+      rest.append(buf, end - buf);
+      break;
+    }
+
+    if (rest.empty()) {
+      rest.assign(buf, nl - buf);
+    } else {
+      rest.append(buf, nl - buf);
+    }
+    if (!rest.empty() || matcher.empty()) {
+      parse_line(rest.c_str());
+    }
+    rest.clear();
+    buf = nl + 1;
+  }
+
+  wake = request_frame();
+  pthread_mutex_unlock(&in_mutex);
+
+  if (wake) {
+    Fl::awake(schedule_frame_cb);
+  }
+}
+
+extern "C" void *progress_getline(void *)
+{
+  char buf[64*1024];
+  std::string rest;
+  ssize_t n;
+
+  while ((n = read(STDIN_FILENO, buf, sizeof(buf))) != 0) {
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    parse_chunk(buf, n, rest);
+  }
+
+  /* last line without newline */
+  if (!rest.empty()) {
+    rest.push_back('\n');
+    std::string line;
+    parse_chunk(rest.c_str(), rest.size(), line);
+  }
+
+  /* all tasks are done once the input is closed */
+  if (tasks_mode) {
+    bool wake;
+
+    pthread_mutex_lock(&in_mutex);
+    in.finished = true;
+    wake = request_frame();
+    pthread_mutex_unlock(&in_mutex);
+
+    if (wake) {
+      Fl::awake(schedule_frame_cb);
+    }
+  }
+
+  return nullptr;
+}
+
+/* called by the main loop whenever an --fd input is readable */
+static void input_fd_cb(int fd, void *v)
+{
+  static char buf[64*1024];
+  input_fd *in_fd = reinterpret_cast<input_fd *>(v);
+  ssize_t n = read(fd, buf, sizeof(buf));
+  bool wake;
+
+  if (n == -1 && (errno == EINTR || errno == EAGAIN)) {
+    return;
+  }
+
+  input_id = in_fd->fd;
+
+  if (n > 0) {
+    parse_chunk(buf, n, in_fd->rest);
+    input_id = -1;
+    return;
+  }
+
+  /* EOF or error; last line without newline */
+  if (!in_fd->rest.empty()) {
+    std::string line;
+    in_fd->rest.push_back('\n');
+    parse_chunk(in_fd->rest.c_str(), in_fd->rest.size(), line);
+    in_fd->rest.clear();
+  }
+  input_id = -1;
+
+  Fl::remove_fd(fd);
+  close(fd);
+  in_fd->fd = -1;
+
+  /* finished once all producers have closed their end */
+  if (--open_inputs == 0) {
+    pthread_mutex_lock(&in_mutex);
+    in.finished = true;
+    wake = request_frame();
+    pthread_mutex_unlock(&in_mutex);
+
+    if (wake) {
+      schedule_frame_cb(NULL);
+    }
+  }
+}
+
+/* one task per descriptor, in the order they were given */
+static bool add_input_fds(const std::vector<int> &fds)
+{
+  char label[32];
+
+  input_fds.resize(fds.size());
+
+  for (size_t i = 0; i < fds.size(); ++i) {
+    if (fcntl(fds[i], F_GETFD) == -1) {
+      std::cerr << "error: --fd: " << fds[i] << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+    input_fds[i].fd = fds[i];
+
+    snprintf(label, sizeof(label) - 1, "fd %d", fds[i]);
+    task_state &ts = find_task(fds[i]);
+    ts.label = label;
+    ts.dirty = true;
+    dirty_tasks.push_back(ts.index);
+  }
+
+  return true;
+}
+
+/* called by the --pipe thread after each transfer */
+static void add_bytes(ssize_t n, bool eof)
+{
+  bool wake;
+
+  pthread_mutex_lock(&in_mutex);
+  in.bytes += n;
+  in.lines++;
+  in.pending++;
+
+  est_bar.add(monotonic_seconds(), in.bytes);
+  in.rate = est_bar.rate();
+
+  if (transfer_size > 0) {
+    in.bar_value = (in.bytes >= transfer_size) ? 100 : in.bytes * 100.0 / transfer_size;
+    in.eta = est_bar.eta(in.bytes, transfer_size);
+  }
+  if (eof) {
+    in.finished = true;
+  }
+  wake = request_frame();
+  pthread_mutex_unlock(&in_mutex);
+
+  if (wake) {
+    Fl::awake(schedule_frame_cb);
+  }
+}
+
+static bool is_pipe(int fd)
+{
+  struct stat st;
+  return (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode));
+}
+
+/* fallback if splice() isn't supported by the file descriptors */
+/* ends a --pipe transfer after a read or write error; `n' bytes got
+ * through before */
+static void pipe_failed(ssize_t n)
+{
+  std::string msg = std::string("error: --pipe: ") + strerror(errno);
+
+  pthread_mutex_lock(&in_mutex);
+  pipe_error = msg;
+  pthread_mutex_unlock(&in_mutex);
+
+  add_bytes(n, true);
+}
+
+static void copy_rw(int fd_in, int fd_out)
+{
+  char *buf = new char[1024*1024];
+  ssize_t n;
+
+  while ((n = read(fd_in, buf, 1024*1024)) != 0) {
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      delete[] buf;
+      pipe_failed(0);
+      return;
+    }
+    for (ssize_t off = 0, w; off < n; off += w) {
+      if ((w = write(fd_out, buf + off, n - off)) == -1) {
+        if (errno == EINTR) {
+          w = 0;
+          continue;
+        }
+        delete[] buf;
+        pipe_failed(off);
+        return;
+      }
+    }
+    add_bytes(n, false);
+  }
+
+  delete[] buf;
+  add_bytes(0, true);
+}
+
+/* returns the number of bytes written, less than `len' after an error */
+static size_t write_all(int fd, const char *buf, size_t len)
+{
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t w = write(fd, buf + done, len - done);
+
+    if (w == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    done += w;
+  }
+
+  return done;
+}
+
+/* splice() fails with EINVAL on terminals and on files opened with O_APPEND */
+static bool can_splice_to(int fd)
+{
+  int fl = fcntl(fd, F_GETFL);
+  return (!isatty(fd) && fl != -1 && !(fl & O_APPEND));
+}
+
+/* Writes `len' bytes that wait in the pipe `pfd_in' to `fd_out'; if
+ * splice() turns out not to work on `fd_out', they are read and written
+ * instead and `use_splice' is cleared. Returns the number of bytes
+ * written, which is less than `len' after an error. */
+static size_t drain_pipe(int pfd_in, int fd_out, size_t len, unsigned int flags, bool &use_splice)
+{
+  char buf[64*1024];
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t w = -1;
+
+    if (use_splice) {
+      if ((w = splice(pfd_in, NULL, fd_out, NULL, len - done, flags)) == -1 && errno == EINVAL) {
+        use_splice = false;
+        continue;
+      }
+    } else if ((w = read(pfd_in, buf, (len - done < sizeof(buf)) ? len - done : sizeof(buf))) > 0) {
+      size_t written = write_all(fd_out, buf, w);
+
+      if (written < static_cast<size_t>(w)) {
+        done += written;
+        break;
+      }
+    }
+
+    if (w == -1 && errno == EINTR) {
+      continue;
+    }
+    if (w <= 0) {
+      break;
+    }
+    done += w;
+  }
+
+  return done;
+}
+
+/* Forwards stdin to stdout with splice(), so the data never passes through
+ * userspace; splice() needs a pipe on one side, so a pipe is put in between
+ * if neither stdin nor stdout is one. */
+extern "C" void *progress_pipe(void *)
+{
+  const size_t chunk = 1024*1024;
+  const unsigned int flags = SPLICE_F_MOVE|SPLICE_F_MORE;
+  int fd_in = STDIN_FILENO, fd_out = STDOUT_FILENO;
+  int pfd[2] = { -1, -1 };
+  bool splice_out = true;
+  ssize_t n, w;
+
+  /* find out before any input was consumed */
+  if ((!is_pipe(fd_out) && !can_splice_to(fd_out)) ||
+      (!is_pipe(fd_in) && !is_pipe(fd_out) && pipe(pfd) == -1))
+  {
+    copy_rw(fd_in, fd_out);
+    return nullptr;
+  }
+
+  for (bool first = true; ; first = false) {
+    if (pfd[0] == -1) {
+      n = splice(fd_in, NULL, fd_out, NULL, chunk, flags);
+    } else {
+      n = splice(fd_in, NULL, pfd[1], NULL, chunk, flags);
+
+      /* the bytes in the pipe were taken from stdin, so they must get out
+       * even if splice() fails on stdout */
+      if (n > 0 && (w = drain_pipe(pfd[0], fd_out, n, flags, splice_out)) < n) {
+        pipe_failed(w);
+        break;
+      }
+    }
+
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (first && errno == EINVAL) {
+        copy_rw(fd_in, fd_out);
+        break;
+      }
+      pipe_failed(0);
+      break;
+    }
+
+    add_bytes(n, n == 0);
+
+    if (n == 0) {
+      break;
+    }
+
+    if (!splice_out) {
+      copy_rw(fd_in, fd_out);
+      break;
+    }
+  }
+
+  if (pfd[0] != -1) {
+    close(pfd[0]);
+    close(pfd[1]);
+  }
+
+  return nullptr;
+}
+
+/* Expands "SRC... DST" into a list of files to copy; DST must be a
+ * directory if there's more than one source. Sets the total size. */
+static bool copy_prepare(const std::vector<std::string> &args)
+{
+  struct stat st;
+  std::string dst = args.back();
+  std::unordered_set<std::string> targets;
+  bool to_dir = (stat(dst.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+
+  if (args.size() > 2 && !to_dir) {
+    std::cerr << "error: --copy: target is not a directory: " << dst << std::endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < args.size() - 1; ++i) {
+    copy_job job;
+
+    if (stat(args[i].c_str(), &st) == -1) {
+      std::cerr << "error: --copy: " << args[i] << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+      std::cerr << "error: --copy: not a regular file: " << args[i] << std::endl;
+      return false;
+    }
+
+    job.src = args[i];
+    job.size = st.st_size;
+    job.dst = dst;
+
+    if (to_dir) {
+      std::vector<char> copy(job.src.begin(), job.src.end());
+      copy.push_back('\0');
+      if (job.dst.back() != '/') {
+        job.dst += "/";
+      }
+      job.dst += basename(copy.data());
+    }
+
+    /* O_TRUNC would destroy the source */
+    struct stat st_dst;
+    if (stat(job.dst.c_str(), &st_dst) == 0 && st_dst.st_dev == st.st_dev && st_dst.st_ino == st.st_ino) {
+      std::cerr << "error: --copy: source and target are the same file: " << job.src << std::endl;
+      return false;
+    }
+
+    /* two sources with the same name would overwrite each other */
+    if (!targets.insert(job.dst).second) {
+      std::cerr << "error: --copy: will not overwrite just-created " << job.dst
+        << " with " << job.src << std::endl;
+      return false;
+    }
+
+    copy_jobs.push_back(job);
+    transfer_size += job.size;
+  }
+
+  return true;
+}
+
+/* Called by the copy thread after each chunk; returns false if the copy
+ * was cancelled. */
+static bool add_copied(ssize_t n, const copy_job &job)
+{
+  unsigned long long done;
+  bool wake, cancelled;
+
+  pthread_mutex_lock(&in_mutex);
+  in.bytes += n;
+  in.lines++;
+  in.pending++;
+  copy_file_done += n;
+
+  est_bar.add(monotonic_seconds(), in.bytes);
+  in.rate = est_bar.rate();
+  in.eta = est_bar.eta(in.bytes, transfer_size);
+
+  done = (copy_file_done > job.size) ? job.size : copy_file_done;
+  in.bar_value = (job.size > 0) ? done * 100.0 / job.size : 100;
+  in.main_value = (transfer_size > 0) ? in.bytes * 100.0 * multi / transfer_size : multi * 100;
+  in.value_changed = true;
+
+  cancelled = copy_cancelled;
+  wake = request_frame();
+  pthread_mutex_unlock(&in_mutex);
 
-public:
-  loop_bar(int X, int Y, int W, int H);
+  if (wake) {
+    Fl::awake(schedule_frame_cb);
+  }
+  return !cancelled;
+}
 
-  double slider_size() const { return slider_size_; }
-  void slider_size(double v) {
-    slider_size_ = (v > 0.0 && v < 1.0) ? v : DEFAULT_SLIDER_SIZE;
+/* Copies a single file: copy_file_range() lets the file system copy
+ * (or reflink) the data without it passing through user space,
+ * sendfile() still avoids the copy into our buffers and plain
+ * read()/write() is the last resort. Returns 0 or an errno value;
+ * a partial file is removed. */
+static int copy_file(const copy_job &job)
+{
+  struct stat st;
+  char *buf = NULL;
+  ssize_t n = 0;
+  int fd_in, fd_out, err = 0;
+  int method = 0;  /* copy_file_range, sendfile, read/write */
+  unsigned long long method_bytes = 0;  /* copied by the current method */
+
+  if ((fd_in = open(job.src.c_str(), O_RDONLY|O_CLOEXEC)) == -1) {
+    return errno;
   }
 
-  double value() const { return value_; }
-  void value(double v) { value_ = v; }
-};
+  if (fstat(fd_in, &st) == -1 ||
+      (fd_out = open(job.dst.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, st.st_mode & 07777)) == -1)
+  {
+    err = errno;
+    close(fd_in);
+    return err;
+  }
 
-static loop_bar         *lp = NULL;
-static Fl_Double_Window *win = NULL;
-static Fl_Box           *box = NULL;
-static Fl_Return_Button *but_ok = NULL;
-static Fl_Button        *but_cancel = NULL;
-static Fl_Progress      *bar = NULL, *bar_main = NULL;
-static int ret = 1;
-static pthread_t t1, t2;
+  posix_fadvise(fd_in, 0, 0, POSIX_FADV_SEQUENTIAL);
 
-static
-unsigned int percent = 0
-,            multi = 1
-,            multi_percent = 0
-,            iteration = 0;
+  while (true) {
+    if (method == 0) {
+      n = copy_file_range(fd_in, NULL, fd_out, NULL, COPY_CHUNK, 0);
+    } else if (method == 1) {
+      n = sendfile(fd_out, fd_in, NULL, COPY_CHUNK);
+    } else {
+      if (!buf && (buf = reinterpret_cast<char *>(malloc(COPY_CHUNK/8))) == NULL) {
+        err = ENOMEM;
+        break;
+      }
 
-static bool running = true
-,           pulsate = false
-,           autoclose = false
-,           hide_cancel = false;
+      if ((n = read(fd_in, buf, COPY_CHUNK/8)) > 0) {
+        for (ssize_t left = n, w; left > 0; left -= w) {
+          if ((w = write(fd_out, buf + n - left, left)) == -1) {
+            if (errno == EINTR) {
+              w = 0;
+              continue;
+            }
+            n = -1;
+            break;
+          }
+        }
+      }
+    }
+
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      /* not supported for this pair of files, try the next method */
+      if (method < 2 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+        method++;
+        method_bytes = 0;
+        continue;
+      }
+      err = errno;
+      break;
+    }
 
-static long pid = -1;
+    /* procfs, sysfs and some network or FUSE file systems return 0
+     * right away although there is data (and st_size may be 0) */
+    if (n == 0 && method < 2 && method_bytes == 0) {
+      method++;
+      continue;
+    }
 
-void loop_bar::draw()
-{
-  int dx, dy, dw, dh, sw, bx1, bx2, by, bh;
-  double max;
+    if (n == 0) {
+      break;
+    }
 
-  /* box borders */
-  dx = Fl::box_dx(box());
-  dy = Fl::box_dy(box());
-  dw = Fl::box_dw(box());
-  dh = Fl::box_dh(box());
+    method_bytes += n;
 
-  /* main box */
-  fl_push_clip(x(), y(), w(), h());
-  draw_box(box(), x(), y(), w(), h(), active_r() ? color() : fl_inactive(color()));
-  fl_pop_clip();
+    if (!add_copied(n, job)) {
+      err = ECANCELED;
+      break;
+    }
+  }
 
-  /* slider */
-  if (value() > 0.0 && value() < 1.0) {
-    sw = slider_size() * w();
-    max = w() + sw;
-    bx1 = x() + dx;
-    bx2 = bx1 + (value() * max) - sw;
-    by = y() + dy;
-    bh = h() - dh;
+  free(buf);
+  close(fd_in);
 
-    fl_push_clip(bx1, by, w() - dw, bh);
-    draw_box(FL_FLAT_BOX, bx2, by, sw - dw, bh, active_r() ? selection_color() : fl_inactive(selection_color()));
-    fl_pop_clip();
+  if (close(fd_out) == -1 && err == 0) {
+    err = errno;
+  }
+
+  if (err != 0) {
+    unlink(job.dst.c_str());
   }
+
+  return err;
 }
 
-loop_bar::loop_bar(int X, int Y, int W, int H)
- : Fl_Widget(X, Y, W, H)
+extern "C" void *progress_copy(void *)
 {
-  box(FL_DOWN_BOX);
-  color(fl_darker(color()));
-  selection_color(fl_lighter(FL_BLUE));
-  value(0.0);
-  slider_size(DEFAULT_SLIDER_SIZE);
+  int err = 0;
+  bool wake;
+
+  for (size_t i = 0; i < copy_jobs.size() && err == 0; ++i) {
+    const copy_job &job = copy_jobs[i];
+    std::vector<char> name(job.src.begin(), job.src.end());
+    name.push_back('\0');
+
+    pthread_mutex_lock(&in_mutex);
+    in_comment = basename(name.data());
+    in.comment_changed = true;
+    in.bar_value = 0;
+    copy_file_done = 0;
+    iteration = i;
+    pthread_mutex_unlock(&in_mutex);
+
+    /* zero-length files don't produce a chunk */
+    if ((err = copy_file(job)) == 0 && job.size == 0) {
+      add_copied(0, job);
+    }
+
+    if (err != 0 && err != ECANCELED) {
+      pthread_mutex_lock(&in_mutex);
+      copy_error = "error: cannot copy " + job.src + " to " + job.dst + ": " + strerror(err);
+      pthread_mutex_unlock(&in_mutex);
+    }
+  }
+
+  pthread_mutex_lock(&in_mutex);
+  in.finished = true;
+  wake = request_frame();
+  pthread_mutex_unlock(&in_mutex);
+
+  if (wake) {
+    Fl::awake(schedule_frame_cb);
+  }
+
+  return nullptr;
 }
 
-static void close_cb(Fl_Widget *, long p) {
-  pthread_cancel(t1);
-  pthread_cancel(t2);
-  win->hide();
-  ret = p;
+/* reads "pos:" and "flags:" from /proc/PID/fdinfo/FD */
+static bool read_fdinfo(long pid, int fd, unsigned long long &pos, int &flags)
+{
+  char path[64], buf[512];
+  const char *p;
+  ssize_t n;
+  int f;
+
+  snprintf(path, sizeof(path) - 1, "/proc/%ld/fdinfo/%d", pid, fd);
+
+  if ((f = open(path, O_RDONLY|O_CLOEXEC)) == -1) {
+    return false;
+  }
+  n = read(f, buf, sizeof(buf) - 1);
+  close(f);
+
+  if (n <= 0) {
+    return false;
+  }
+  buf[n] = '\0';
+
+  if ((p = strstr(buf, "pos:")) == NULL || sscanf(p + 4, "%llu", &pos) != 1) {
+    return false;
+  }
+  if ((p = strstr(buf, "flags:")) == NULL || sscanf(p + 6, "%o", &flags) != 1) {
+    flags = 0;
+  }
+  return true;
 }
 
-static void cancel_cb(Fl_Widget *o)
+/* size of the file or block device behind /proc/PID/fd/FD, 0 if unknown */
+static unsigned long long fd_size(long pid, int fd)
 {
-  if (pid > getpid()) {
-    kill(pid, 1);
+  char path[64];
+  struct stat st;
+  off_t end;
+  int f;
+
+  snprintf(path, sizeof(path) - 1, "/proc/%ld/fd/%d", pid, fd);
+
+  if (stat(path, &st) == -1) {
+    return 0;
   }
-  close_cb(o, 1);
+  if (S_ISREG(st.st_mode)) {
+    return st.st_size;
+  }
+  if (S_ISBLK(st.st_mode) && (f = open(path, O_RDONLY|O_CLOEXEC)) != -1) {
+    end = lseek(f, 0, SEEK_END);
+    close(f);
+    return (end > 0) ? end : 0;
+  }
+  return 0;
 }
 
-static void progress_finished(void)
+/* picks the largest file that the process has opened for reading,
+ * which is usually the source of a cp, tar or dd */
+static int find_monitor_fd(long pid)
 {
-  if (autoclose) {
-    close_cb(NULL, 0);
-  } else {
-    if (!hide_cancel) {
-      but_cancel->deactivate();
-    }
-    but_ok->activate();
+  char path[64];
+  unsigned long long pos, size, max = 0;
+  int fd, flags, found = -1;
+  struct dirent *e;
+  DIR *dir;
+
+  snprintf(path, sizeof(path) - 1, "/proc/%ld/fd", pid);
+
+  if ((dir = opendir(path)) == NULL) {
+    return -1;
   }
 
-  if (pulsate) {
-    lp->value(0.0);
-    lp->deactivate();
+  while ((e = readdir(dir)) != NULL) {
+    if (e->d_name[0] < '0' || e->d_name[0] > '9') {
+      continue;
+    }
+    fd = atoi(e->d_name);
+
+    if (read_fdinfo(pid, fd, pos, flags) && (flags & O_ACCMODE) == O_RDONLY &&
+        (size = fd_size(pid, fd)) > max)
+    {
+      max = size;
+      found = fd;
+    }
   }
+  closedir(dir);
+
+  return found;
 }
 
-static void parse_line(const char *ch)
+/* Samples the file position of another process at a low fixed rate;
+ * the monitored process isn't involved at all. */
+static void monitor_cb(void *)
 {
-  if (running) {
-    if (ch[0] == '#' && ch[1] != '\0') {
-      /* "#comment" line found, change the label */
-      box->copy_label(ch + 1);
-    } else if (!pulsate && ch[0] >= '0' && ch[0] <= '9') {
-      char buf[16] = {0};
-
-      /* number found, update the progress bar */
-      percent = atoi(ch);
-      if (percent >= 100) {
-        percent = 100;
-        running = multi > 1;
-        iteration++;
-      }
-      snprintf(buf, sizeof(buf) - 1, "%d%%", percent);
-      bar->value(percent);
-      bar->copy_label(buf);
-
-      /* update the main progress bar too if --multi=n was given */
-      if (multi > 1) {
-        if (percent == 100) {
-          /* reset % for next iteration */
-          percent = 0;
-        }
-        multi_percent = iteration * 100 + percent;
-        if (multi_percent >= multi * 100) {
-          multi_percent = multi * 100;
-          running = false;
-        }
-        snprintf(buf, sizeof(buf) - 1, "%d%%", multi_percent / multi);
-        bar_main->value(multi_percent);
-        bar_main->copy_label(buf);
+  unsigned long long pos = 0;
+  char buf[16] = {0};
+  double now = monotonic_seconds();
+  int flags;
+
+  if (done) {
+    return;
+  }
+
+  if (pid_terminated(monitor_pid)) {
+    /* the process has stopped, or is a zombie nobody reaped yet */
+    progress_finished();
+    return;
+  }
+
+  if (monitor_fd == -1 && monitor_auto) {
+    monitor_fd = find_monitor_fd(monitor_pid);
+    est_bar.reset();
+  }
+
+  if (monitor_fd != -1) {
+    if (read_fdinfo(monitor_pid, monitor_fd, pos, flags)) {
+      transfer_size = fd_size(monitor_pid, monitor_fd);
+      est_bar.add(now, pos);
+      update_transfer_label(pos, est_bar.rate(), est_bar.eta(pos, transfer_size));
+
+      if (transfer_size > 0) {
+        double value = (pos >= transfer_size) ? 100 : pos * 100.0 / transfer_size;
+        snprintf(buf, sizeof(buf) - 1, "%d%%", static_cast<int>(value));
+        set_bar(bar, value, buf);
       }
-    } else if (pulsate && strcmp(ch, "STOP") == 0) {
-      /* stop now */
-      running = false;
+    } else if (monitor_auto) {
+      /* file was closed, look for the next one */
+      monitor_fd = -1;
+    } else {
+      progress_finished();
+      return;
     }
   }
 
-  /* should be a separate "if"-statement, so we can finish
-   * immediately after a "STOP" signal was sent */
-  if (!running) {
-    progress_finished();
+  Fl::repeat_timeout(MONITOR_INTERVAL, monitor_cb);
+}
+
+/* true if the segment belongs to a dialog that is gone, e.g. one that
+ * was killed before it could remove it */
+static bool shm_stale(const char *path)
+{
+  const struct fltk_dialog_shm *old;
+  struct stat st;
+  void *p;
+  bool stale = false;
+  int fd;
+
+  if ((fd = shm_open(path, O_RDONLY|O_CLOEXEC, 0)) == -1) {
+    return false;
+  }
+
+  if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(*old)) &&
+      (p = mmap(NULL, sizeof(*old), PROT_READ, MAP_SHARED, fd, 0)) != MAP_FAILED)
+  {
+    old = reinterpret_cast<const struct fltk_dialog_shm *>(p);
+    stale = (old->magic == FLTK_DIALOG_SHM_MAGIC && old->version == FLTK_DIALOG_SHM_VERSION &&
+             old->owner > 0 && pid_terminated(old->owner));
+    munmap(p, sizeof(*old));
   }
+  close(fd);
 
-  Fl::redraw();
+  return stale;
 }
 
-extern "C" void *progress_getline(void *)
+static bool shm_create(const char *name)
 {
-  std::string line;
-  while (std::getline(std::cin, line)) {
-    Fl::lock();
-    parse_line(line.c_str());
-    Fl::unlock();
-    Fl::awake(win);
+  const int flags = O_CREAT|O_EXCL|O_RDWR|O_CLOEXEC;
+  char path[256];
+  int fd;
+
+  fltk_dialog_shm_path(name, path, sizeof(path));
+  shm_path = path;
+
+  /* never take over (and later unlink) the segment of another dialog,
+   * only one that was left behind */
+  if ((fd = shm_open(path, flags, 0600)) == -1 && errno == EEXIST) {
+    if (!shm_stale(path)) {
+      errno = EEXIST;
+      return false;
+    }
+    shm_unlink(path);
+    fd = shm_open(path, flags, 0600);
   }
-  return nullptr;
+
+  if (fd == -1) {
+    return false;
+  }
+
+  if (ftruncate(fd, sizeof(*shm)) == -1) {
+    close(fd);
+    shm_unlink(path);
+    return false;
+  }
+
+  void *p = mmap(NULL, sizeof(*shm), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (p == MAP_FAILED) {
+    shm_unlink(path);
+    return false;
+  }
+
+  shm = reinterpret_cast<struct fltk_dialog_shm *>(p);
+  memset(shm, 0, sizeof(*shm));
+  shm->owner = getpid();
+  shm->version = FLTK_DIALOG_SHM_VERSION;
+  __atomic_store_n(&shm->magic, FLTK_DIALOG_SHM_MAGIC, __ATOMIC_RELEASE);
+
+  return true;
 }
 
-extern "C" void *pulsate_bar_thread(void *)
+/* Samples the shared memory segment once per frame; producers never
+ * have to wait for the dialog and the dialog never waits for them. */
+static void shm_cb(void *)
 {
-  while (running) {
-    Fl::lock();
+  struct fltk_dialog_shm_snapshot snap;
+  char buf[96] = {0};
+  double value;
+  bool stop, changed = false;
+
+  if (done) {
+    return;
+  }
+
+  /* records that are being written are picked up on a later frame;
+   * older tickets than the ones shown are ignored */
+  fltk_dialog_shm_read(shm, &snap);
+  stop = (snap.flags & FLTK_DIALOG_SHM_STOP);
+
+  if (snap.text.ticket > shm_text_ticket) {
+    shm_text_ticket = snap.text.ticket;
+    changed = true;
 
-    double val = lp->value() + 0.001;
-    if (val > 1.0) {
-      val = 0.0;
+    snap.text.status[sizeof(snap.text.status) - 1] = '\0';
+    if (!box->label() || strcmp(box->label(), snap.text.status) != 0) {
+      box->copy_label(snap.text.status);
+      redraw_status();
     }
-    lp->value(val);
-    Fl::redraw();
+  }
+
+  if (snap.progress.ticket > shm_progress_ticket) {
+    const struct fltk_dialog_shm_slot &r = snap.progress;
+
+    shm_progress_ticket = r.ticket;
+    changed = true;
+
+    value = (r.total > 0) ? r.done * 100 / r.total : 0;
+    value = (value > 100) ? 100 : (value < 0) ? 0 : value;
 
-    if (pid > getpid() && kill(pid, 0) == -1) {
-      running = false;  /* the watched process has stopped */
-      pid = -1;
+    est_bar.add(monotonic_seconds(), value);
+
+    if (r.total == 100) {
+      format_bar_label(buf, sizeof(buf), value, 0, 0, est_bar.rate(), est_bar.eta(value, 100));
+    } else {
+      format_bar_label(buf, sizeof(buf), value, r.done, r.total, est_bar.rate(), est_bar.eta(value, 100));
     }
+    set_bar(bar, value, buf);
 
-    Fl::unlock();
-    Fl::awake(win);
+    if (value >= 100) {
+      stop = true;
+    }
+  }
 
-    /* has an effect on the pulsate speed */
-    usleep(1200);
+  if (changed) {
+    frames++;
   }
 
-  if (!running) {
+  if (stop) {
     progress_finished();
-    Fl::redraw();
+    return;
   }
 
-  return nullptr;
+  Fl::repeat_timeout(frame_interval, shm_cb);
+}
+
+/* `fltk-dialog --shm=NAME --update=LINE' */
+int progress_shm_update(const char *name, const char *line)
+{
+  struct fltk_dialog_shm *p = fltk_dialog_shm_open(name);
+  double value, done, total;
+
+  if (!p) {
+    std::cerr << "error: cannot open progress channel: " << name << std::endl;
+    return 1;
+  }
+
+  if (line[0] == '#') {
+    fltk_dialog_shm_status(p, line + 1);
+  } else if (strcmp(line, "STOP") == 0) {
+    fltk_dialog_shm_stop(p);
+  } else if (line[0] >= '0' && line[0] <= '9') {
+    value = parse_percent(line, done, total);
+    if (total > 0) {
+      fltk_dialog_shm_set(p, done, total);
+    } else {
+      fltk_dialog_shm_set(p, value, 100);
+    }
+  } else {
+    std::cerr << "error: invalid progress update: " << line << std::endl;
+    fltk_dialog_shm_close(p);
+    return 1;
+  }
+
+  fltk_dialog_shm_close(p);
+  return 0;
+}
+
+/* Runs on the main loop at the frame rate; the slider is moved by the time
+ * elapsed since the last frame, so a late frame doesn't slow the animation
+ * down and only the bar itself gets redrawn. */
+static void pulsate_cb(void *)
+{
+  double now = monotonic_seconds();
+  double val = lp->value() + (now - last_frame) * PULSATE_SPEED;
+
+  last_frame = now;
+
+  if (done) {
+    return;
+  }
+
+  lp->value(val - floor(val));
+  redraw_widget(lp);
+
+  Fl::repeat_timeout(frame_interval, pulsate_cb);
+}
+
+/* Writes the --timing report as tab separated values; `dest' is a file
+ * name or the number of an open file descriptor. Times are in seconds
+ * since the dialog was started, the last stage ends when the input has
+ * finished or at `end' if it was cancelled. */
+static void write_timing(const char *dest, double end)
+{
+  const char *p = dest;
+  FILE *fp;
+  int fd;
+
+  while (*p >= '0' && *p <= '9') {
+    p++;
+  }
+
+  if (p != dest && *p == '\0') {
+    fd = dup(atoi(dest));
+    fp = (fd == -1) ? NULL : fdopen(fd, "w");
+  } else {
+    fp = fopen(dest, "w");
+  }
+
+  if (!fp) {
+    std::cerr << "error: --timing: " << dest << ": " << strerror(errno) << std::endl;
+    return;
+  }
+
+  pthread_mutex_lock(&in_mutex);
+
+  fprintf(fp, "#stage\tstart\tduration\tupdates\tname\n");
+
+  for (size_t i = 0; i < timing.size(); ++i) {
+    const timing_entry &e = timing[i];
+    double next = (i + 1 < timing.size()) ? timing[i + 1].start : (timing_end >= 0) ? timing_end : end;
+    std::string name = e.name;
+
+    for (size_t j = 0; j < name.size(); ++j) {
+      if (name[j] == '\t') {
+        name[j] = ' ';
+      }
+    }
+
+    fprintf(fp, "%u\t%.3f\t%.3f\t%lu\t%s\n", e.stage, e.start - start_time, next - e.start,
+            e.updates, name.c_str());
+  }
+
+  pthread_mutex_unlock(&in_mutex);
+
+  fclose(fp);
 }
 
-int dialog_progress(bool pulsate_, unsigned int multi_, long pid_, bool autoclose_, bool hide_cancel_)
+int dialog_progress(const progress_options &opt)
 {
   Fl_Group *g;
   Fl_Box *dummy;
-  int h = 140, offset = 0, range = 80;
+  Fl_Widget *pane = NULL;
+  int h = 140, offset = 0, pane_y, pane_h = 0, range = 80, min_h;
 
   if (!msg) {
     msg = "Progress indicator";
@@ -268,11 +1989,58 @@ int dialog_progress(bool pulsate_, unsigned int multi_, long pid_, bool autoclos
     title = "FLTK progress window";
   }
 
-  pulsate = pulsate_;
-  multi = pulsate ? 1 : multi_;
-  pid = pid_;
-  autoclose = autoclose_;
-  hide_cancel = hide_cancel_;
+  pipe_mode = opt.pipe;
+  transfer_size = opt.size;
+  tasks_mode = opt.tasks;
+
+  if (opt.match) {
+    std::string error;
+    matcher.compile(opt.match, error);  /* validated by the caller */
+  }
+
+  monitor_pid = opt.monitor_pid;
+  if (monitor_pid > 0) {
+    monitor_fd = opt.fds.empty() ? -1 : opt.fds[0];
+    monitor_auto = opt.fds.empty();
+  } else if (!opt.fds.empty()) {
+    /* every input descriptor gets its own bar in the task list */
+    if (!add_input_fds(opt.fds)) {
+      return 1;
+    }
+    tasks_mode = true;
+  }
+
+  if (opt.log > 0) {
+    in_log.resize(opt.log);
+  }
+
+  /* without a size there's nothing to measure the progress against */
+  pulsate = opt.pulsate || (pipe_mode && transfer_size == 0);
+  multi = pulsate ? 1 : opt.multi;
+
+  if (!opt.copy.empty()) {
+    copy_mode = true;
+    if (!copy_prepare(opt.copy)) {
+      return 1;
+    }
+    /* the main bar shows the total of several files */
+    multi = (copy_jobs.size() > 1) ? copy_jobs.size() : 1;
+  }
+  autoclose = opt.autoclose;
+  hide_cancel = opt.hide_cancel;
+
+  if (opt.fps > 0) {
+    frame_interval = 1.0/opt.fps;
+  }
+
+  if (opt.shm && !shm_create(opt.shm)) {
+    if (errno == EEXIST) {
+      std::cerr << "error: another dialog is using the shared memory segment: " << shm_path << std::endl;
+    } else {
+      std::cerr << "error: cannot create shared memory segment: " << shm_path << std::endl;
+    }
+    return 1;
+  }
 
   if (hide_cancel && autoclose) {
     h -= 36;
@@ -282,6 +2050,17 @@ int dialog_progress(bool pulsate_, unsigned int multi_, long pid_, bool autoclos
     offset = 40;
   }
 
+  /* room for the task list or the log below the bar */
+  if (tasks_mode) {
+    pane_h = 200;
+  } else if (!in_log.empty()) {
+    pane_h = 150;
+  }
+  pane_y = 90 + offset;
+  if (pane_h > 0) {
+    offset += pane_h + 10;
+  }
+
   win = new Fl_Double_Window(320, h + offset, title);
   win->callback(cancel_cb);
   {
@@ -303,7 +2082,7 @@ int dialog_progress(bool pulsate_, unsigned int multi_, long pid_, bool autoclos
           bar_main->labelcolor(FL_WHITE);
           bar_main->value(0);
         }
-        bar = new Fl_Progress(10, 50 + offset, 300, 30, "0%");
+        bar = new Fl_Progress(10, bar_main ? 90 : 50, 300, 30, "0%");
         bar->minimum(0);
         bar->maximum(100);
         bar->color(fl_darker(FL_GRAY));
@@ -312,6 +2091,12 @@ int dialog_progress(bool pulsate_, unsigned int multi_, long pid_, bool autoclos
         bar->value(0);
       }
 
+      if (tasks_mode) {
+        pane = tasks = new task_list(10, pane_y, 300, pane_h);
+      } else if (!in_log.empty()) {
+        pane = log_pane = new log_view(10, pane_y, 300, pane_h, in_log.size());
+      }
+
       if (hide_cancel && autoclose) {
         dummy = new Fl_Box(10, 81 + offset, 300, 1);
       } else {
@@ -338,12 +2123,18 @@ int dialog_progress(bool pulsate_, unsigned int multi_, long pid_, bool autoclos
         dummy = new Fl_Box(but_x, 103 + offset, 1, 1);
       }
       dummy->box(FL_NO_BOX);
+
+      if (pane) {
+        /* let the task list or the log take up the extra height */
+        dummy->position(dummy->x(), pane->y() + pane->h() / 2);
+      }
     }
     g->resizable(dummy);
     g->end();
   }
+  min_h = win->h() - pane_h * 3 / 4;
   set_size(win, g);
-  set_size_range(win, range, win->h());
+  set_size_range(win, range, min_h);
   set_position(win);
   win->end();
 
@@ -355,13 +2146,96 @@ int dialog_progress(bool pulsate_, unsigned int multi_, long pid_, bool autoclos
   set_always_on_top(win);
 
   if (pulsate) {
-    /* the pulsating bar is running in its own thread */
-    pthread_create(&t1, 0, &pulsate_bar_thread, nullptr);
+    /* the pulsating bar is animated by a timer on the main loop */
+    last_frame = monotonic_seconds();
+    Fl::add_timeout(frame_interval, pulsate_cb);
+  }
+  last_apply = start_time = monotonic_seconds();
+
+  if (opt.timing) {
+    timing_mode = true;
+    timing_begin(start_time, "");
   }
-  pthread_create(&t2, 0, &progress_getline, nullptr);
+
+  if (shm) {
+    /* nothing is read from stdin */
+    Fl::add_timeout(0, shm_cb);
+  } else if (monitor_pid > 0) {
+    /* nothing is read from stdin */
+    Fl::add_timeout(0, monitor_cb);
+  } else if (!input_fds.empty()) {
+    /* all descriptors are served by the main loop, no thread needed;
+     * a read() must never block it */
+    for (size_t i = 0; i < input_fds.size(); ++i) {
+      int fd = input_fds[i].fd;
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      Fl::add_fd(fd, FL_READ, input_fd_cb, &input_fds[i]);
+    }
+    open_inputs = input_fds.size();
+
+    /* show the empty rows right away */
+    frame_pending = true;
+    Fl::add_timeout(0, frame_cb);
+  } else if (copy_mode) {
+    have_thread = (pthread_create(&t, 0, &progress_copy, nullptr) == 0);
+  } else if (pipe_mode) {
+    /* a closed STDOUT shows up as EPIPE */
+    signal(SIGPIPE, SIG_IGN);
+    have_thread = (pthread_create(&t, 0, &progress_pipe, nullptr) == 0);
+  } else {
+    have_thread = (pthread_create(&t, 0, &progress_getline, nullptr) == 0);
+  }
+
+  watch_pids(opt.watch_pids);
 
   Fl::run();
 
+  if (copy_mode && have_thread) {
+    pthread_join(t, NULL);
+
+    if (!copy_error.empty()) {
+      std::cerr << copy_error << std::endl;
+      ret = 1;
+    }
+  }
+
+  if (pipe_mode) {
+    pthread_mutex_lock(&in_mutex);
+    if (!pipe_error.empty()) {
+      std::cerr << pipe_error << std::endl;
+      ret = 1;
+    }
+    pthread_mutex_unlock(&in_mutex);
+  }
+
+  if (opt.stats) {
+    double elapsed = monotonic_seconds() - start_time;
+    unsigned long long window_area = win->w() * win->h();
+
+    std::cerr << "progress: " << in.lines << " updates, " << frames << " frames, "
+      << collapsed << " updates collapsed" << std::endl;
+
+    if (elapsed > 0 && window_area > 0) {
+      std::cerr << "progress: redrawn " << static_cast<unsigned long long>(redraw_area / elapsed)
+        << " pixels/s, " << static_cast<double>(redraw_area) / window_area / elapsed
+        << " windows/s" << std::endl;
+    }
+  }
+
+  if (opt.timing) {
+    write_timing(opt.timing, monotonic_seconds());
+  }
+
+  if (shm) {
+    munmap(shm, sizeof(*shm));
+    shm_unlink(shm_path.c_str());
+  }
+
+  /* a watched process has failed */
+  if (ret == 0 && pid_status > 0) {
+    ret = pid_status;
+  }
+
   return ret;
 }
 
@@ -0,0 +1,229 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Shared memory progress channel of `fltk-dialog --progress --shm=NAME'.
+ *
+ * The dialog creates the segment and samples it once per frame, producers
+ * map it and update it without any system call:
+ *
+ *   struct fltk_dialog_shm *p = fltk_dialog_shm_open("myjob");
+ *   for (...) {
+ *     fltk_dialog_shm_set(p, done, total);
+ *   }
+ *   fltk_dialog_shm_status(p, "Done.");
+ *   fltk_dialog_shm_stop(p);
+ *   fltk_dialog_shm_close(p);
+ *
+ * Shell scripts can use `fltk-dialog --shm=NAME --update=LINE', where LINE
+ * is anything that --progress accepts on stdin ("42", "1834/90210",
+ * "#comment" or "STOP").
+ *
+ * Producers never wait for each other or for the dialog.  Every update
+ * draws a ticket from a shared counter and writes a complete record into
+ * the slot of its ticket, guarded by a seqlock of that slot alone.  A slot
+ * that is being written by someone else (or by a producer that was killed
+ * in the middle) is skipped in favour of the next ticket, so the worst a
+ * dead producer can do is to leave one slot unusable.  The dialog takes
+ * the consistent record with the highest ticket and ignores tickets it
+ * has already seen.  Progress and status text have slots of their own, so
+ * one doesn't overwrite the other; the flags are set atomically.
+ */
+
+#ifndef PROGRESS_SHM_H
+#define PROGRESS_SHM_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define FLTK_DIALOG_SHM_MAGIC    0x4c444c46  /* "FLDL" */
+#define FLTK_DIALOG_SHM_VERSION  2
+#define FLTK_DIALOG_SHM_SLOTS    4
+#define FLTK_DIALOG_SHM_STOP     (1 << 0)
+
+/* a record of either kind, only one of them is used */
+struct fltk_dialog_shm_slot {
+  uint32_t seq;
+  uint64_t ticket;  /* 0 if never written */
+  double done;
+  double total;  /* 100 if done is a percentage */
+  char status[240];
+};
+
+struct fltk_dialog_shm {
+  uint32_t magic;
+  uint32_t version;
+  int32_t owner;  /* pid of the dialog */
+  uint32_t flags;
+  uint64_t ticket;
+  struct fltk_dialog_shm_slot progress[FLTK_DIALOG_SHM_SLOTS];
+  struct fltk_dialog_shm_slot text[FLTK_DIALOG_SHM_SLOTS];
+};
+
+/* what the dialog reads */
+struct fltk_dialog_shm_snapshot {
+  uint32_t flags;
+  struct fltk_dialog_shm_slot progress;
+  struct fltk_dialog_shm_slot text;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* "myjob" -> "/fltk-dialog-myjob" */
+static inline void fltk_dialog_shm_path(const char *name, char *buf, size_t size)
+{
+  snprintf(buf, size, "/fltk-dialog-%s", name);
+}
+
+static inline struct fltk_dialog_shm *fltk_dialog_shm_open(const char *name)
+{
+  struct fltk_dialog_shm *p;
+  char path[256];
+  int fd;
+
+  fltk_dialog_shm_path(name, path, sizeof(path));
+
+  if ((fd = shm_open(path, O_RDWR, 0)) == -1) {
+    return NULL;
+  }
+  p = (struct fltk_dialog_shm *)mmap(NULL, sizeof(*p), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  if (__atomic_load_n(&p->magic, __ATOMIC_ACQUIRE) != FLTK_DIALOG_SHM_MAGIC ||
+      p->version != FLTK_DIALOG_SHM_VERSION)
+  {
+    munmap(p, sizeof(*p));
+    return NULL;
+  }
+  return p;
+}
+
+static inline void fltk_dialog_shm_close(struct fltk_dialog_shm *p) {
+  munmap(p, sizeof(*p));
+}
+
+/* Takes a ticket and the seqlock of the slot it stands for; returns the
+ * slot with `seq' set to its odd sequence number, or NULL if every slot
+ * tried was busy and the update is dropped. */
+static inline struct fltk_dialog_shm_slot *fltk_dialog_shm_claim(struct fltk_dialog_shm *p,
+                                                                 struct fltk_dialog_shm_slot *slots,
+                                                                 uint32_t *seq)
+{
+  int tries;
+
+  for (tries = 0; tries < 2*FLTK_DIALOG_SHM_SLOTS; tries++) {
+    uint64_t t = __atomic_add_fetch(&p->ticket, 1, __ATOMIC_RELAXED);
+    struct fltk_dialog_shm_slot *r = &slots[t % FLTK_DIALOG_SHM_SLOTS];
+    uint32_t s = __atomic_load_n(&r->seq, __ATOMIC_RELAXED);
+
+    /* busy, try the slot of the next ticket instead of waiting */
+    if ((s & 1) == 0 && __atomic_compare_exchange_n(&r->seq, &s, s + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      r->ticket = t;
+      *seq = s + 1;
+      return r;
+    }
+  }
+  return NULL;
+}
+
+static inline void fltk_dialog_shm_publish(struct fltk_dialog_shm_slot *r, uint32_t seq) {
+  __atomic_store_n(&r->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/* set the progress to done/total; use total=100 for a percentage */
+static inline void fltk_dialog_shm_set(struct fltk_dialog_shm *p, double done, double total)
+{
+  struct fltk_dialog_shm_slot *r;
+  uint32_t seq;
+
+  if ((r = fltk_dialog_shm_claim(p, p->progress, &seq)) != NULL) {
+    r->done = done;
+    r->total = total;
+    fltk_dialog_shm_publish(r, seq);
+  }
+}
+
+static inline void fltk_dialog_shm_status(struct fltk_dialog_shm *p, const char *text)
+{
+  struct fltk_dialog_shm_slot *r;
+  uint32_t seq;
+
+  if ((r = fltk_dialog_shm_claim(p, p->text, &seq)) != NULL) {
+    strncpy(r->status, text, sizeof(r->status) - 1);
+    r->status[sizeof(r->status) - 1] = '\0';
+    fltk_dialog_shm_publish(r, seq);
+  }
+}
+
+/* the dialog sees the updates made before the stop */
+static inline void fltk_dialog_shm_stop(struct fltk_dialog_shm *p) {
+  __atomic_fetch_or(&p->flags, FLTK_DIALOG_SHM_STOP, __ATOMIC_RELEASE);
+}
+
+/* copies the consistent slot with the highest ticket into `out'; slots
+ * that are being written are skipped, not waited for */
+static inline void fltk_dialog_shm_newest(const struct fltk_dialog_shm_slot *slots, struct fltk_dialog_shm_slot *out)
+{
+  struct fltk_dialog_shm_slot r;
+  int i;
+
+  for (i = 0; i < FLTK_DIALOG_SHM_SLOTS; i++) {
+    uint32_t seq = __atomic_load_n(&slots[i].seq, __ATOMIC_ACQUIRE);
+
+    if (seq & 1) {
+      continue;
+    }
+    memcpy(&r, &slots[i], sizeof(r));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slots[i].seq, __ATOMIC_RELAXED) == seq && r.ticket > out->ticket) {
+      *out = r;
+    }
+  }
+}
+
+/* Takes a snapshot for the dialog, a ticket of 0 means the record was
+ * never set.  Never blocks. */
+static inline void fltk_dialog_shm_read(const struct fltk_dialog_shm *p, struct fltk_dialog_shm_snapshot *out)
+{
+  memset(out, 0, sizeof(*out));
+  /* the flags first, so the updates made before a stop are seen */
+  out->flags = __atomic_load_n(&p->flags, __ATOMIC_ACQUIRE);
+  fltk_dialog_shm_newest(p->progress, &out->progress);
+  fltk_dialog_shm_newest(p->text, &out->text);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !PROGRESS_SHM_H */
@@ -0,0 +1,90 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+
+#include "rate_estimator.hpp"
+
+rate_estimator::rate_estimator(double interval, double tau)
+  : interval_(interval), tau_(tau)
+{
+  reset();
+}
+
+void rate_estimator::reset()
+{
+  head_ = count_ = 0;
+  rate_ = 0;
+}
+
+void rate_estimator::add(double time, double value)
+{
+  const sample &last = ring_[head_];
+  double dt, window, instant;
+  unsigned int oldest;
+
+  if (count_ > 0 && value < last.value) {
+    reset();
+  }
+
+  if (count_ == 0) {
+    ring_[head_].time = time;
+    ring_[head_].value = value;
+    count_ = 1;
+    return;
+  }
+
+  dt = time - last.time;
+
+  if (dt < interval_) {
+    return;
+  }
+
+  /* rate over the whole window covered by the ring buffer */
+  oldest = (head_ + RING_SIZE + 1 - count_) % RING_SIZE;
+  window = time - ring_[oldest].time;
+  instant = (value - ring_[oldest].value) / window;
+
+  if (rate_ > 0) {
+    rate_ += (1.0 - exp(-dt / tau_)) * (instant - rate_);
+  } else {
+    rate_ = instant;
+  }
+
+  head_ = (head_ + 1) % RING_SIZE;
+  ring_[head_].time = time;
+  ring_[head_].value = value;
+
+  if (count_ < RING_SIZE) {
+    count_++;
+  }
+}
+
+double rate_estimator::eta(double value, double target) const
+{
+  if (rate_ <= 0 || value >= target) {
+    return -1;
+  }
+  return (target - value) / rate_;
+}
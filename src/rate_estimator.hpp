@@ -0,0 +1,64 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RATE_ESTIMATOR_HPP
+#define RATE_ESTIMATOR_HPP
+
+/* Estimates the rate of a growing value (percent, bytes, items) and the time
+ * left until a target is reached.
+ * Samples are kept in a small time-stamped ring buffer, at most one every
+ * `interval' seconds, and the rate measured over the ring is smoothed with an
+ * exponentially weighted moving average. Every call is O(1), so it can be
+ * fed with each single update of a high-rate producer.
+ */
+class rate_estimator
+{
+  enum { RING_SIZE = 32 };
+
+  struct sample {
+    double time, value;
+  };
+
+  sample ring_[RING_SIZE];
+  unsigned int head_, count_;
+  double rate_, interval_, tau_;
+
+public:
+  /* interval: minimum distance between two samples in seconds
+   * tau: time constant of the moving average in seconds */
+  rate_estimator(double interval = 0.1, double tau = 3.0);
+
+  void reset();
+
+  /* feed a new value; a value smaller than the previous one restarts the estimation */
+  void add(double time, double value);
+
+  /* units per second, or 0 if still unknown */
+  double rate() const { return rate_; }
+
+  /* seconds until `target' is reached, or -1 if unknown */
+  double eta(double value, double target) const;
+};
+
+#endif  /* !RATE_ESTIMATOR_HPP */
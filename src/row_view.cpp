@@ -0,0 +1,119 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "row_view.hpp"
+
+#ifdef __GNUC__
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wshadow"
+# pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#include <FL/fl_draw.H>
+#ifdef __GNUC__
+# pragma GCC diagnostic pop
+#endif
+
+row_view::row_view(int X, int Y, int W, int H)
+ : Fl_Group(X, Y, W, H),
+   row_h_(FL_NORMAL_SIZE + 10)
+{
+  int sw = Fl::scrollbar_size();
+
+  box(FL_DOWN_BOX);
+  color(FL_BACKGROUND2_COLOR);
+
+  scrollbar_ = new Fl_Scrollbar(X + W - Fl::box_dx(box()) - sw, Y + Fl::box_dy(box()),
+                                sw, H - Fl::box_dh(box()));
+  scrollbar_->callback(scroll_cb, this);
+  scrollbar_->linesize(1);
+  end();
+}
+
+void row_view::scroll_cb(Fl_Widget *, void *v) {
+  reinterpret_cast<row_view *>(v)->redraw();
+}
+
+void row_view::update_scrollbar(int top)
+{
+  int n = rows();
+  int vis = visible_rows();
+
+  if (top > n - vis) {
+    top = (n > vis) ? n - vis : 0;
+  }
+  if (top < 0) {
+    top = 0;
+  }
+  scrollbar_->value(top, vis, 0, n);
+}
+
+void row_view::draw()
+{
+  int X = x() + Fl::box_dx(box());
+  int Y = y() + Fl::box_dy(box());
+  int W = w() - Fl::box_dw(box()) - scrollbar_->w();
+  int H = h() - Fl::box_dh(box());
+  int top = top_row();
+  int last = top + visible_rows() + 1;
+
+  if (damage() & FL_DAMAGE_ALL) {
+    draw_box();
+  }
+
+  fl_push_clip(X, Y, W, H);
+  fl_rectf(X, Y, W, H, color());
+
+  if (last > static_cast<int>(rows())) {
+    last = rows();
+  }
+  for (int i = top; i < last; ++i) {
+    draw_row(i, X, Y + (i - top) * row_h_, W, row_h_);
+  }
+  fl_pop_clip();
+
+  if (damage() & FL_DAMAGE_ALL) {
+    draw_child(*scrollbar_);
+  } else {
+    update_child(*scrollbar_);
+  }
+}
+
+int row_view::handle(int event)
+{
+  if (event == FL_MOUSEWHEEL && Fl::event_dy() != 0) {
+    update_scrollbar(top_row() + Fl::event_dy());
+    redraw();
+    return 1;
+  }
+  return Fl_Group::handle(event);
+}
+
+void row_view::resize(int X, int Y, int W, int H)
+{
+  Fl_Group::resize(X, Y, W, H);
+  scrollbar_->resize(X + W - Fl::box_dx(box()) - scrollbar_->w(), Y + Fl::box_dy(box()),
+                     scrollbar_->w(), H - Fl::box_dh(box()));
+  update_scrollbar(top_row());
+}
@@ -0,0 +1,85 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef ROW_VIEW_HPP
+#define ROW_VIEW_HPP
+
+#ifdef __GNUC__
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wshadow"
+# pragma GCC diagnostic ignored "-Wunused-parameter"
+# if __GNUC__ > 7
+#  pragma GCC diagnostic ignored "-Wcast-function-type"
+# endif
+#endif
+
+#include <FL/Fl.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Scrollbar.H>
+
+#ifdef __GNUC__
+# pragma GCC diagnostic pop
+#endif
+
+#include <stddef.h>
+
+
+/* Base of the lists that show rows of one fixed height next to a vertical
+ * scrollbar. Rows are not widgets: subclasses tell how many there are and
+ * how to draw one, and only the rows that are currently visible get
+ * drawn, so a list can hold any number of them. */
+class row_view : public Fl_Group
+{
+  Fl_Scrollbar *scrollbar_;
+  int row_h_;
+
+  static void scroll_cb(Fl_Widget *, void *v);
+
+protected:
+  row_view(int X, int Y, int W, int H);
+
+  /* number of rows */
+  virtual size_t rows() const = 0;
+
+  /* draws row `i' into the given area, clipped to the list */
+  virtual void draw_row(size_t i, int X, int Y, int W, int H) = 0;
+
+  /* call from the constructor, rows() can't be used before */
+  void row_height(int h) { row_h_ = h; }
+
+  /* Updates the scrollbar to the number of rows and scrolls to row `top';
+   * it's kept within the range that fills the view. */
+  void update_scrollbar(int top);
+
+public:
+  int top_row() const { return scrollbar_->value(); }
+  int visible_rows() const { return (h() - Fl::box_dh(box())) / row_h_; }
+
+  void draw();
+  int handle(int event);
+  void resize(int X, int Y, int W, int H);
+};
+
+#endif  /* !ROW_VIEW_HPP */
@@ -0,0 +1,101 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "task_list.hpp"
+
+#ifdef __GNUC__
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wshadow"
+# pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#include <FL/fl_draw.H>
+#ifdef __GNUC__
+# pragma GCC diagnostic pop
+#endif
+
+task_list::task_list(int X, int Y, int W, int H)
+ : row_view(X, Y, W, H)
+{
+  selection_color(fl_lighter(FL_BLUE));
+  update_scrollbar(0);
+}
+
+bool task_list::set(size_t index, long id, double value, const std::string &label)
+{
+  int top = top_row();
+
+  if (index >= rows_.size()) {
+    row r = { id, value, label };
+    rows_.push_back(r);
+    update_scrollbar(top);
+  } else {
+    row &r = rows_[index];
+    r.id = id;
+    r.value = value;
+    r.label = label;
+  }
+
+  return (static_cast<int>(index) >= top && static_cast<int>(index) < top + visible_rows());
+}
+
+void task_list::draw_row(size_t i, int X, int Y, int W, int H)
+{
+  const row &r = rows_[i];
+  char buf[64];
+  int label_w = W * 2 / 5;
+  int bar_x = X + label_w + 4;
+  int bar_w = W - label_w - 8;
+  int fill_w;
+  double v = (r.value < 0) ? 0 : (r.value > 100) ? 100 : r.value;
+
+  /* "17: copying shard" */
+  if (r.label.empty()) {
+    snprintf(buf, sizeof(buf) - 1, "%ld", r.id);
+  } else {
+    snprintf(buf, sizeof(buf) - 1, "%ld: %s", r.id, r.label.c_str());
+  }
+  fl_font(labelfont(), labelsize());
+  fl_color(active_r() ? FL_FOREGROUND_COLOR : fl_inactive(FL_FOREGROUND_COLOR));
+  fl_push_clip(X, Y, label_w, H);
+  fl_draw(buf, X + 4, Y, label_w - 4, H, FL_ALIGN_LEFT);
+  fl_pop_clip();
+
+  /* bar */
+  Fl_Boxtype b = FL_THIN_DOWN_BOX;
+  draw_box(b, bar_x, Y + 3, bar_w, H - 6, fl_darker(FL_GRAY));
+  fill_w = (bar_w - Fl::box_dw(b)) * v / 100;
+  if (fill_w > 0) {
+    fl_rectf(bar_x + Fl::box_dx(b), Y + 3 + Fl::box_dy(b), fill_w, H - 6 - Fl::box_dh(b), selection_color());
+  }
+
+  if (v == static_cast<int>(v)) {
+    snprintf(buf, sizeof(buf) - 1, "%d%%", static_cast<int>(v));
+  } else {
+    snprintf(buf, sizeof(buf) - 1, "%.1f%%", v);
+  }
+  fl_color(FL_WHITE);
+  fl_draw(buf, bar_x, Y, bar_w, H, FL_ALIGN_CENTER);
+}
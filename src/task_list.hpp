@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TASK_LIST_HPP
+#define TASK_LIST_HPP
+
+#include <string>
+#include <vector>
+
+#include "row_view.hpp"
+
+
+/* A scrollable list of labeled progress bars, one row per task. */
+class task_list : public row_view
+{
+  struct row {
+    long id;
+    double value;
+    std::string label;
+  };
+
+  std::vector<row> rows_;
+
+protected:
+  size_t rows() const { return rows_.size(); }
+  void draw_row(size_t i, int X, int Y, int W, int H);
+
+public:
+  task_list(int X, int Y, int W, int H);
+
+  size_t size() const { return rows_.size(); }
+
+  /* Sets the values of the row at `index'; a new row is appended if `index'
+   * equals size(). Returns true if the row is currently visible. */
+  bool set(size_t index, long id, double value, const std::string &label);
+};
+
+#endif  /* !TASK_LIST_HPP */
@@ -0,0 +1,200 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <string.h>
+
+#include "text_style.hpp"
+
+#define ESC '\033'
+
+/* nearest color of the 6x6x6 cube of the 256 color palette */
+static uint8_t cube_index(long r, long g, long b)
+{
+  long c[3] = { r, g, b };
+
+  for (int i = 0; i < 3; ++i) {
+    if (c[i] < 48) {
+      c[i] = 0;
+    } else if (c[i] < 115) {
+      c[i] = 1;
+    } else {
+      c[i] = (c[i] > 255) ? 5 : (c[i] - 35) / 40;
+    }
+  }
+
+  return 16 + c[0]*36 + c[1]*6 + c[2];
+}
+
+/* applies the parameters of "ESC [ ... m" */
+static void apply_sgr(const long *par, int n, text_style &s)
+{
+  if (n == 0) {
+    s = text_style();
+    return;
+  }
+
+  for (int i = 0; i < n; ++i) {
+    long p = par[i];
+
+    if (p == 0) {
+      s = text_style();
+    } else if (p == 1) {
+      s.attr |= STYLE_BOLD;
+    } else if (p == 2) {
+      s.attr |= STYLE_DIM;
+    } else if (p == 3) {
+      s.attr |= STYLE_ITALIC;
+    } else if (p == 4) {
+      s.attr |= STYLE_UNDERLINE;
+    } else if (p == 7) {
+      s.attr |= STYLE_INVERSE;
+    } else if (p == 22) {
+      s.attr &= ~(STYLE_BOLD|STYLE_DIM);
+    } else if (p == 23) {
+      s.attr &= ~STYLE_ITALIC;
+    } else if (p == 24) {
+      s.attr &= ~STYLE_UNDERLINE;
+    } else if (p == 27) {
+      s.attr &= ~STYLE_INVERSE;
+    } else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+      s.fg = (p >= 90) ? p - 90 + 8 : p - 30;
+      s.attr |= STYLE_FG;
+    } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+      s.bg = (p >= 100) ? p - 100 + 8 : p - 40;
+      s.attr |= STYLE_BG;
+    } else if (p == 39) {
+      s.attr &= ~STYLE_FG;
+    } else if (p == 49) {
+      s.attr &= ~STYLE_BG;
+    } else if (p == 38 || p == 48) {
+      /* 38;5;N or 38;2;R;G;B */
+      uint8_t c;
+
+      if (i + 2 < n && par[i + 1] == 5) {
+        c = par[i + 2] & 0xff;
+        i += 2;
+      } else if (i + 4 < n && par[i + 1] == 2) {
+        c = cube_index(par[i + 2], par[i + 3], par[i + 4]);
+        i += 4;
+      } else {
+        break;
+      }
+
+      if (p == 38) {
+        s.fg = c;
+        s.attr |= STYLE_FG;
+      } else {
+        s.bg = c;
+        s.attr |= STYLE_BG;
+      }
+    }
+  }
+}
+
+void strip_ansi(const char *text, size_t len, std::string &out, std::vector<style_run> &runs, text_style &style)
+{
+  const char *p = text, *end = text + len;
+
+  out.clear();
+  runs.clear();
+
+  if (!style.is_default()) {
+    style_run r = { 0, style };
+    runs.push_back(r);
+  }
+
+  while (p < end) {
+    const char *esc = reinterpret_cast<const char *>(memchr(p, ESC, end - p));
+
+    if (!esc) {
+      out.append(p, end - p);
+      break;
+    }
+    out.append(p, esc - p);
+    p = esc + 1;
+
+    if (p == end) {
+      break;
+    }
+
+    if (*p == '[') {
+      /* CSI: parameters and intermediate bytes, then a final byte */
+      long par[16];
+      int n = 0;
+      bool have = false;
+
+      par[0] = 0;
+
+      for (p++; p < end && (*p < 0x40 || *p > 0x7e); ++p) {
+        if (*p >= '0' && *p <= '9') {
+          if (par[n] < 100000) {
+            par[n] = par[n] * 10 + (*p - '0');
+          }
+          have = true;
+        } else if ((*p == ';' || *p == ':') && n < 15) {
+          par[++n] = 0;
+          have = true;
+        }
+      }
+
+      if (p < end && *p == 'm') {
+        text_style prev = style;
+        apply_sgr(par, have ? n + 1 : 0, style);
+
+        if (style != prev) {
+          style_run r = { static_cast<uint32_t>(out.size()), style };
+
+          /* several sequences in a row give one run */
+          if (!runs.empty() && runs.back().offset == r.offset) {
+            runs.back() = r;
+          } else {
+            runs.push_back(r);
+          }
+        }
+      }
+      if (p < end) {
+        p++;
+      }
+    } else if (*p == ']') {
+      /* OSC, ends with BEL or ESC \ */
+      for (p++; p < end; ++p) {
+        if (*p == '\a') {
+          p++;
+          break;
+        }
+        if (*p == ESC && p + 1 < end && p[1] == '\\') {
+          p += 2;
+          break;
+        }
+      }
+    } else {
+      /* two byte sequence */
+      p++;
+    }
+  }
+
+  /* a run that would start behind the text is only kept for the next line */
+  if (!runs.empty() && runs.back().offset == out.size()) {
+    runs.pop_back();
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TEXT_STYLE_HPP
+#define TEXT_STYLE_HPP
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+  STYLE_BOLD      = 1,
+  STYLE_DIM       = 2,
+  STYLE_ITALIC    = 4,
+  STYLE_UNDERLINE = 8,
+  STYLE_INVERSE   = 16,
+  STYLE_FG        = 32,  /* fg is set, otherwise the default color is used */
+  STYLE_BG        = 64   /* bg is set */
+};
+
+/* colors and attributes as set by ANSI SGR sequences; colors are indices
+ * into the 256 color xterm palette */
+struct text_style {
+  uint8_t fg, bg, attr;
+
+  text_style() : fg(0), bg(0), attr(0) {}
+  bool is_default() const { return attr == 0; }
+  bool operator==(const text_style &o) const { return fg == o.fg && bg == o.bg && attr == o.attr; }
+  bool operator!=(const text_style &o) const { return !(*this == o); }
+};
+
+/* the style from byte `offset' of a line on */
+struct style_run {
+  uint32_t offset;
+  text_style style;
+};
+
+/* Copies a line to `out' without its escape sequences. SGR sequences
+ * change `style', which carries over to the next line; every change is
+ * added to `runs' with its offset in `out'. A line that starts with a
+ * style other than the default one gets a run at offset 0. */
+void strip_ansi(const char *text, size_t len, std::string &out, std::vector<style_run> &runs, text_style &style);
+
+#endif  /* !TEXT_STYLE_HPP */
@@ -0,0 +1,490 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <limits.h>
+
+#include "text_view.hpp"
+
+#ifdef __GNUC__
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wshadow"
+# pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#include <FL/fl_draw.H>
+#include <FL/fl_utf8.h>
+#ifdef __GNUC__
+# pragma GCC diagnostic pop
+#endif
+
+#define TAB_WIDTH 8
+
+text_view::text_view(int X, int Y, int W, int H, line_store *store)
+ : Fl_Group(X, Y, W, H),
+   store_(store),
+   search_(NULL),
+   textfont_(FL_COURIER),
+   textsize_(FL_NORMAL_SIZE),
+   char_w_(0),
+   autoscroll_(false),
+   following_(false),
+   filter_(false),
+   dropped_(store->evicted())
+{
+  int sw = Fl::scrollbar_size();
+
+  box(FL_DOWN_BOX);
+  color(FL_BACKGROUND2_COLOR);
+  line_h_ = textsize_ + 4;
+
+  vscroll_ = new Fl_Scrollbar(X + W - Fl::box_dx(box()) - sw, Y + Fl::box_dy(box()),
+                              sw, H - Fl::box_dh(box()) - sw);
+  vscroll_->callback(scroll_cb, this);
+  vscroll_->linesize(1);
+
+  hscroll_ = new Fl_Scrollbar(X + Fl::box_dx(box()), Y + H - Fl::box_dy(box()) - sw,
+                              W - Fl::box_dw(box()) - sw, sw);
+  hscroll_->type(FL_HORIZONTAL);
+  hscroll_->callback(scroll_cb, this);
+  end();
+
+  update_scrollbars();
+}
+
+void text_view::scroll_cb(Fl_Widget *, void *v)
+{
+  text_view *tv = reinterpret_cast<text_view *>(v);
+  tv->following_ = tv->at_bottom();
+  tv->redraw();
+}
+
+void text_view::update_scrollbars()
+{
+  int n = rows();
+  int vis = visible_lines();
+  int top = vscroll_->value();
+  int tw = text_w();
+  int width, left = hscroll_->value();
+  long long wide;
+
+  if (top > n - vis) {
+    top = (n > vis) ? n - vis : 0;
+  }
+  vscroll_->value(top, vis, 0, n);
+
+  /* the width is only known once the font was measured in draw() */
+  wide = static_cast<long long>(char_w_) * (store_->max_length() + 1);
+  width = (wide > INT_MAX / 2) ? INT_MAX / 2 : wide;
+  if (left > width - tw) {
+    left = (width > tw) ? width - tw : 0;
+  }
+  hscroll_->value(left, tw, 0, (width > tw) ? width : tw);
+  hscroll_->linesize(char_w_ > 0 ? char_w_ : 1);
+}
+
+void text_view::scroll_to(int top)
+{
+  vscroll_->value(top);
+  update_scrollbars();
+  following_ = at_bottom();
+  redraw();
+}
+
+void text_view::update()
+{
+  uint64_t total = dropped_rows();
+  int dropped = total - dropped_;
+
+  dropped_ = total;
+
+  if (autoscroll_ && following_) {
+    /* no search, the top line follows directly from the row count */
+    vscroll_->value(static_cast<int>(rows()) - visible_lines());
+  } else if (dropped > 0) {
+    /* keep showing the same lines while the oldest ones are dropped */
+    vscroll_->value(vscroll_->value() - dropped);
+  }
+  update_scrollbars();
+  redraw();
+}
+
+void text_view::filter(bool b)
+{
+  bool was = filtering();
+  size_t top = vscroll_->value();
+
+  filter_ = b;
+
+  if (was == filtering()) {
+    return;
+  }
+
+  /* keep the top line, or the next matching line, at the top */
+  if (was) {
+    top = (top < search_->count()) ? search_->match(top) : store_->size();
+  } else {
+    top = search_->lower_bound(top);
+  }
+
+  dropped_ = dropped_rows();
+  vscroll_->value((autoscroll_ && following_) ? rows() : top);
+  update_scrollbars();
+  following_ = at_bottom();
+  redraw();
+}
+
+void text_view::search_changed()
+{
+  dropped_ = dropped_rows();
+
+  if (filtering() && !(autoscroll_ && following_)) {
+    vscroll_->value(0);
+  }
+  update();
+}
+
+void text_view::next_match()
+{
+  size_t i;
+
+  if (!search_ || search_->count() == 0) {
+    return;
+  }
+
+  if (filtering()) {
+    scroll_to(vscroll_->value() + 1);
+    return;
+  }
+
+  /* wrap around at the end */
+  if ((i = search_->lower_bound(vscroll_->value() + 1)) == search_->count()) {
+    i = 0;
+  }
+  scroll_to(search_->match(i));
+}
+
+/* the 256 color xterm palette */
+static Fl_Color palette_color(uint8_t i)
+{
+  static const uchar base[16][3] = {
+    {0,0,0}, {205,0,0}, {0,205,0}, {205,205,0}, {0,0,238}, {205,0,205}, {0,205,205}, {229,229,229},
+    {127,127,127}, {255,0,0}, {0,255,0}, {255,255,0}, {92,92,255}, {255,0,255}, {0,255,255}, {255,255,255}
+  };
+  static const uchar level[6] = { 0, 95, 135, 175, 215, 255 };
+
+  if (i < 16) {
+    return fl_rgb_color(base[i][0], base[i][1], base[i][2]);
+  }
+  if (i < 232) {
+    i -= 16;
+    return fl_rgb_color(level[i / 36], level[(i / 6) % 6], level[i % 6]);
+  }
+  return fl_rgb_color(8 + (i - 232) * 10, 8 + (i - 232) * 10, 8 + (i - 232) * 10);
+}
+
+/* Draws the columns of a line that are visible, tabs expanded. The line
+ * is drawn in pieces of one style each, so a style costs one font and
+ * color switch, not one per character. */
+void text_view::draw_line(const char *text, size_t len, const style_run *runs, size_t nruns,
+                          int X, int Y, int W)
+{
+  const char *p = text, *end = text + len;
+  int first = hscroll_->value() / char_w_;
+  int last = first + W / char_w_ + 2;
+  int col = 0, x0 = X - hscroll_->value();
+  int base = Y + line_h_ - fl_descent() - 2;
+  const char *hl = NULL, *hl_end = NULL, *hl_limit = text;
+  int hl_col = -1;
+  size_t r = 0;
+  text_style style;
+  piece pc = { -1, 0, 0, 0, style };
+  Fl_Color fg = fl_color();
+  Fl_Font cur_font = textfont_;
+
+  buf_.clear();
+  spans_.clear();
+  pieces_.clear();
+
+  /* A column takes at most 4 bytes, so matches are only searched for in
+   * the bytes that can be visible; a line can be very long. */
+  if (search_ && !search_->needle().empty()) {
+    const std::string &s = search_->needle();
+    hl_limit = text + std::min(len, static_cast<size_t>(last) * 4 + s.size());
+    if ((hl = find_substring(text, hl_limit - text, s.data(), s.size())) != NULL) {
+      hl_end = hl + s.size();
+    }
+  }
+
+  while (p < end && col < last) {
+    int n = 1;
+
+    /* a new style starts a new piece */
+    if (r < nruns && static_cast<size_t>(p - text) >= runs[r].offset) {
+      while (r < nruns && static_cast<size_t>(p - text) >= runs[r].offset) {
+        style = runs[r++].style;
+      }
+      if (pc.col != -1) {
+        pc.end_col = col;
+        pc.len = buf_.size() - pc.pos;
+        pieces_.push_back(pc);
+        pc.col = -1;
+      }
+      pc.pos = buf_.size();
+      pc.style = style;
+    }
+
+    /* columns of the matches */
+    if (hl) {
+      if (p >= hl_end) {
+        const std::string &s = search_->needle();
+        spans_.push_back(std::make_pair(hl_col, col));
+        hl_col = -1;
+        if ((hl = find_substring(hl_end, hl_limit - hl_end, s.data(), s.size())) != NULL) {
+          hl_end = hl + s.size();
+        }
+      }
+      if (hl && hl_col == -1 && p >= hl) {
+        hl_col = col;
+      }
+    }
+
+    if (*p == '\t') {
+      int next = (col / TAB_WIDTH + 1) * TAB_WIDTH;
+      for ( ; col < next; ++col) {
+        if (col >= first) {
+          if (pc.col == -1) {
+            pc.col = col;
+          }
+          buf_.push_back(' ');
+        }
+      }
+      p++;
+      continue;
+    }
+
+    if (static_cast<unsigned char>(*p) >= 0x80) {
+      n = fl_utf8len1(*p);
+      if (n < 1 || p + n > end) {
+        n = 1;
+      }
+    }
+
+    if (col >= first) {
+      if (pc.col == -1) {
+        pc.col = col;
+      }
+      buf_.append(p, n);
+    }
+    p += n;
+    col++;
+  }
+
+  if (pc.col != -1) {
+    pc.end_col = col;
+    pc.len = buf_.size() - pc.pos;
+    pieces_.push_back(pc);
+  }
+  if (hl_col != -1) {
+    spans_.push_back(std::make_pair(hl_col, col));
+  }
+
+  /* backgrounds, then the matches on top of them */
+  for (size_t i = 0; i < pieces_.size(); ++i) {
+    const text_style &st = pieces_[i].style;
+    Fl_Color bg;
+
+    if (st.attr & STYLE_INVERSE) {
+      bg = (st.attr & STYLE_FG) ? palette_color(st.fg) : fg;
+    } else if (st.attr & STYLE_BG) {
+      bg = palette_color(st.bg);
+    } else {
+      continue;
+    }
+    fl_rectf(x0 + pieces_[i].col * char_w_, Y, (pieces_[i].end_col - pieces_[i].col) * char_w_, line_h_, bg);
+  }
+
+  for (size_t i = 0; i < spans_.size(); ++i) {
+    fl_rectf(x0 + spans_[i].first * char_w_, Y, (spans_[i].second - spans_[i].first) * char_w_, line_h_,
+             fl_color_average(FL_YELLOW, color(), 0.6f));
+  }
+
+  for (size_t i = 0; i < pieces_.size(); ++i) {
+    const piece &pi = pieces_[i];
+    const text_style &st = pi.style;
+    Fl_Color c = (st.attr & STYLE_FG) ? palette_color(st.fg) : fg;
+    Fl_Font font = textfont_;
+
+    if (st.attr & STYLE_INVERSE) {
+      c = (st.attr & STYLE_BG) ? palette_color(st.bg) : color();
+    }
+    if (st.attr & STYLE_DIM) {
+      c = fl_color_average(c, color(), 0.5f);
+    }
+    if (st.attr & STYLE_BOLD) {
+      font |= FL_BOLD;
+    }
+    if (st.attr & STYLE_ITALIC) {
+      font |= FL_ITALIC;
+    }
+
+    if (font != cur_font) {
+      fl_font(font, textsize_);
+      cur_font = font;
+    }
+    fl_color(c);
+    fl_draw(buf_.data() + pi.pos, pi.len, x0 + pi.col * char_w_, base);
+
+    if (st.attr & STYLE_UNDERLINE) {
+      fl_xyline(x0 + pi.col * char_w_, base + 1, x0 + pi.end_col * char_w_ - 1);
+    }
+  }
+
+  if (cur_font != textfont_) {
+    fl_font(textfont_, textsize_);
+  }
+  fl_color(fg);
+}
+
+void text_view::draw()
+{
+  int X = text_x(), Y = text_y(), W = text_w(), H = text_h();
+  int top, last;
+
+  fl_font(textfont_, textsize_);
+
+  if (search_) {
+    search_->prune();
+  }
+
+  if (char_w_ == 0) {
+    char_w_ = fl_width('m');
+    if (char_w_ < 1) {
+      char_w_ = 1;
+    }
+    update_scrollbars();
+  }
+
+  if (damage() & FL_DAMAGE_ALL) {
+    draw_box();
+  }
+
+  top = vscroll_->value();
+  last = top + visible_lines() + 1;
+  if (last > static_cast<int>(rows())) {
+    last = rows();
+  }
+
+  fl_push_clip(X, Y, W, H);
+  fl_rectf(X, Y, W, H, color());
+  fl_color(active_r() ? FL_FOREGROUND_COLOR : fl_inactive(FL_FOREGROUND_COLOR));
+
+  for (int i = top; i < last; ++i) {
+    size_t line = row_line(i), len, nruns = 0;
+    const char *text = store_->line(line, len);
+    const style_run *runs = store_->styles(line, nruns);
+    draw_line(text, len, runs, nruns, X + 3, Y + (i - top) * line_h_, W);
+  }
+  fl_pop_clip();
+
+  /* corner between the scrollbars */
+  fl_rectf(hscroll_->x() + hscroll_->w(), vscroll_->y() + vscroll_->h(), vscroll_->w(), hscroll_->h(), FL_BACKGROUND_COLOR);
+
+  if (damage() & FL_DAMAGE_ALL) {
+    draw_child(*vscroll_);
+    draw_child(*hscroll_);
+  } else {
+    update_child(*vscroll_);
+    update_child(*hscroll_);
+  }
+}
+
+int text_view::handle(int event)
+{
+  int vis = visible_lines();
+
+  switch (event) {
+    case FL_MOUSEWHEEL:
+      if (Fl::event_dy() != 0) {
+        scroll_to(vscroll_->value() + Fl::event_dy() * 3);
+        return 1;
+      }
+      if (Fl::event_dx() != 0) {
+        hscroll_->value(hscroll_->value() + Fl::event_dx() * char_w_ * 3);
+        update_scrollbars();
+        redraw();
+        return 1;
+      }
+      break;
+
+    case FL_PUSH:
+      if (!Fl::event_inside(vscroll_) && !Fl::event_inside(hscroll_)) {
+        take_focus();
+      }
+      break;
+
+    case FL_FOCUS:
+    case FL_UNFOCUS:
+      return 1;
+
+    case FL_KEYBOARD:
+      switch (Fl::event_key()) {
+        case FL_Up:
+          scroll_to(vscroll_->value() - 1);
+          return 1;
+        case FL_Down:
+          scroll_to(vscroll_->value() + 1);
+          return 1;
+        case FL_Page_Up:
+          scroll_to(vscroll_->value() - vis);
+          return 1;
+        case FL_Page_Down:
+          scroll_to(vscroll_->value() + vis);
+          return 1;
+        case FL_Home:
+          scroll_to(0);
+          return 1;
+        case FL_End:
+          scroll_to(rows());
+          return 1;
+        default:
+          break;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return Fl_Group::handle(event);
+}
+
+void text_view::resize(int X, int Y, int W, int H)
+{
+  int sw = vscroll_->w();
+
+  Fl_Widget::resize(X, Y, W, H);
+  vscroll_->resize(X + W - Fl::box_dx(box()) - sw, Y + Fl::box_dy(box()), sw, H - Fl::box_dh(box()) - sw);
+  hscroll_->resize(X + Fl::box_dx(box()), Y + H - Fl::box_dy(box()) - sw, W - Fl::box_dw(box()) - sw, sw);
+  update();
+}
@@ -0,0 +1,126 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, djcj <djcj@gmx.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TEXT_VIEW_HPP
+#define TEXT_VIEW_HPP
+
+#ifdef __GNUC__
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wshadow"
+# pragma GCC diagnostic ignored "-Wunused-parameter"
+# if __GNUC__ > 7
+#  pragma GCC diagnostic ignored "-Wcast-function-type"
+# endif
+#endif
+
+#include <FL/Fl.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Scrollbar.H>
+
+#ifdef __GNUC__
+# pragma GCC diagnostic pop
+#endif
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "line_search.hpp"
+#include "line_store.hpp"
+
+
+/* A read-only view of a line_store. Only the visible lines, and of these
+ * only the visible columns, are drawn, so the cost of drawing and
+ * scrolling doesn't depend on the number of lines. */
+class text_view : public Fl_Group
+{
+  line_store *store_;
+  line_search *search_;
+  Fl_Scrollbar *vscroll_, *hscroll_;
+  Fl_Font textfont_;
+  Fl_Fontsize textsize_;
+  int line_h_, char_w_;
+  bool autoscroll_, following_, filter_;
+  uint64_t dropped_;
+  std::string buf_;
+  std::vector<std::pair<int, int> > spans_;  /* highlighted columns */
+
+  /* the visible part of a line, split where the style changes */
+  struct piece {
+    int col, end_col;
+    size_t pos, len;  /* in buf_ */
+    text_style style;
+  };
+  std::vector<piece> pieces_;
+
+  static void scroll_cb(Fl_Widget *, void *v);
+
+  int text_x() const { return x() + Fl::box_dx(box()); }
+  int text_y() const { return y() + Fl::box_dy(box()); }
+  int text_w() const { return w() - Fl::box_dw(box()) - vscroll_->w(); }
+  int text_h() const { return h() - Fl::box_dh(box()) - hscroll_->h(); }
+  int visible_lines() const { return text_h() / line_h_; }
+
+  /* with a filter the rows are the matching lines, otherwise all lines */
+  bool filtering() const { return filter_ && search_ && !search_->needle().empty(); }
+  size_t rows() const { return filtering() ? search_->count() : store_->size(); }
+  size_t row_line(size_t row) const { return filtering() ? search_->match(row) : row; }
+  uint64_t dropped_rows() { return filtering() ? search_->prune() : store_->evicted(); }
+
+  bool at_bottom() const { return vscroll_->value() >= static_cast<int>(rows()) - visible_lines(); }
+  void update_scrollbars();
+  void scroll_to(int top);
+  void draw_line(const char *text, size_t len, const style_run *runs, size_t nruns,
+                 int X, int Y, int W);
+
+public:
+  text_view(int X, int Y, int W, int H, line_store *store);
+
+  /* Keep the last line visible; this pauses while the user has scrolled
+   * up and resumes once the view is scrolled back to the bottom. */
+  void autoscroll(bool b) { autoscroll_ = following_ = b; }
+  bool autoscroll() const { return autoscroll_; }
+
+  /* Highlights the matches of a search; with filter() set only the
+   * matching lines are shown, like grep on a live tail. */
+  void search(line_search *s) { search_ = s; }
+  void filter(bool b);
+  bool filter() const { return filter_; }
+
+  /* call after a new search was started */
+  void search_changed();
+
+  /* scrolls to the next matching line below the top one */
+  void next_match();
+
+  /* call after lines were added to or dropped from the store, or after
+   * more lines were searched */
+  void update();
+
+  void draw();
+  int handle(int event);
+  void resize(int X, int Y, int W, int H);
+};
+
+#endif  /* !TEXT_VIEW_HPP */
@@ -22,14 +22,32 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <deque>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <signal.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <spawn.h>
+#include <wordexp.h>
 
+#include "decompress.hpp"
 #include "fltk-dialog.hpp"
+#include "line_index.hpp"
+#include "line_search.hpp"
+#include "line_store.hpp"
+#include "text_style.hpp"
+#include "text_view.hpp"
 
 /***
 
@@ -39,12 +57,160 @@
 ) | \
  ./fltk-dialog --text-info --auto-scroll --checkbox="I confirm" --no-system-colors
 
+seq 50000000 | ./fltk-dialog --text-info
+./fltk-dialog --text-info --filename=/var/log/syslog
+journalctl -f | ./fltk-dialog --text-info --auto-scroll --max-lines=10000
+
+Follow a file through truncation and rotation:
+seq 5 > /tmp/follow.log; ./fltk-dialog --text-info --auto-scroll --follow=/tmp/follow.log &
+echo appended >> /tmp/follow.log
+: > /tmp/follow.log; echo truncated >> /tmp/follow.log
+mv /tmp/follow.log /tmp/follow.log.1; echo rotated > /tmp/follow.log
+
+Press Ctrl+F to search; Enter jumps to the next match and "Filter" shows
+only the matching lines. Typing in the search field while 10M lines are
+scanned must not lag:
+seq 10000000 | ./fltk-dialog --text-info
+
+Search while a large file is still being indexed; no match may be shown
+twice or beyond the lines indexed so far, and once indexing is done
+there must be exactly 10000 matches:
+seq 100000000 | sed 's/^.*0000$/match &/' > /tmp/big.txt
+./fltk-dialog --text-info --filename=/tmp/big.txt   (press Ctrl+F at once)
+
+Compressed input, on STDIN or with --filename; the first lines should
+show up right away while the rest is decompressed:
+seq 50000000 | gzip > /tmp/seq.gz; seq 50000000 | zstd > /tmp/seq.zst
+./fltk-dialog --text-info < /tmp/seq.gz
+./fltk-dialog --text-info --filename=/tmp/seq.zst
+
+Run a command, STDERR is shown in red and the exit status is returned
+after pressing OK:
+./fltk-dialog --text-info --command="ls -l / /nonexistent"; echo $?
+./fltk-dialog --text-info --auto-scroll --command="make -C src"
+
+Pass-through; the pipe must run at full speed no matter how fast the
+window is, the view then shows a count of the lines it left out:
+seq 100000000 | ./fltk-dialog --text-info --tee | pv > /dev/null
+seq 100000000 | ./fltk-dialog --text-info --tee | md5sum; seq 100000000 | md5sum
+
+ANSI colors; ingest of a colorized compiler log should stay within a small
+factor of the same log without colors:
+for i in $(seq 500000); do \
+ printf '\033[1msrc/main.cpp:%d:5: \033[1;31merror: \033[0mexpected \033[1m;\033[0m\n' $i; \
+done > /tmp/color.log; sed 's/\x1b\[[0-9;]*m//g' /tmp/color.log > /tmp/plain.log
+for f in plain color; do \
+ /usr/bin/time -f "$f: %es, %MkB" \
+ ./fltk-dialog --text-info --auto-close --no-cancel < /tmp/$f.log; \
+done
+
+Indexing speed of --filename with short, medium and long lines (4 GiB each):
+for n in 8 80 1000; do \
+ yes "$(head -c $((n-1)) /dev/zero | tr '\0' x)" | head -c 4G > /tmp/lines$n.txt; \
+ /usr/bin/time -f "$n bytes per line: %es, %MkB" \
+ ./fltk-dialog --text-info --filename=/tmp/lines$n.txt --auto-close --no-cancel; \
+done
+
+Throughput with --auto-scroll, the time should grow linearly with the lines:
+for n in 1000000 2000000 4000000 8000000; do \
+ seq $n > /tmp/seq.txt; /usr/bin/time -f "$n lines: %es, %MkB" \
+ ./fltk-dialog --text-info --auto-scroll --auto-close --no-cancel < /tmp/seq.txt; \
+done
+
 ***/
 
 static Fl_Double_Window *win;
-static Fl_Multi_Browser *browser;
+static text_view *view;
+static line_store store;
+static line_search search(&store);
+
+/* search bar, toggled with Ctrl+F */
+#define SEARCH_BAR_H 26
+static Fl_Group *search_bar;
+static Fl_Input *search_input;
+static Fl_Box *search_status;
+
+/* --filename */
+static const char *map = NULL;
+static size_t map_size = 0;
+
+/* --follow */
+static std::string follow_path, follow_name;
+static int follow_fd = -1, inotify_fd = -1, follow_wd = -1, dir_wd = -1;
+static ino_t follow_ino = 0;
+static off_t follow_offset = 0;
+static std::string follow_rest;
+static std::vector<char> follow_buf;
+static bool follow_pending = false, follow_started = false;
+
+/* bytes read per event loop iteration; a large file is read in steps so
+ * the window stays responsive */
+#define FOLLOW_CHUNK (4*1024*1024)
+
+/* --command; STDOUT and STDERR of the child are read on the event loop,
+ * each with its own partial line and SGR state */
+struct cmd_stream {
+  int fd;
+  bool is_stderr;
+  std::string rest;
+  text_style style;
+};
+static cmd_stream cmd_out = { -1, false, std::string(), text_style() };
+static cmd_stream cmd_err = { -1, true, std::string(), text_style() };
+static pid_t cmd_pid = -1;
+static int cmd_status = -1;  /* set once the child exited */
+
+/* bytes read per callback, so a chatty child can't block the window */
+#define CMD_READ_MAX (1024*1024)
+
+/* how often the child is polled after it closed its output */
+#define CMD_POLL_INTERVAL 0.05
+
+extern char **environ;
+
+/* bytes of a mapped file indexed per thread and step; the view is
+ * updated after each step */
+#define INDEX_BLOCK (16*1024*1024)
+
+/* the first step is small to show the first lines right away */
+#define INDEX_FIRST_BLOCK (256*1024)
+
+/* Compressed input is decompressed on a thread of its own into a pipe
+ * that ti_getline() reads, so decompressing overlaps with splitting the
+ * output into lines and with drawing them. */
+struct decompress_job {
+  compression type;
+  int in_fd, out_fd;
+  std::string head;  /* bytes already read from in_fd */
+  const char *data;  /* mapped input */
+  size_t size;
+};
+
+/* a larger pipe means fewer context switches between the threads */
+#define DECOMPRESS_PIPE_SIZE (1024*1024)
+
+/* --tee: the forwarding thread passes chunks to the display thread
+ * through a queue of limited size; if it is full, chunks are dropped
+ * instead of waiting for the display */
+struct tee_chunk {
+  char *data;
+  size_t len;
+  bool dropped_before;  /* chunks were dropped in front of this one */
+  bool mid_line;        /* and the last of them ended within a line */
+};
+static std::deque<tee_chunk> tee_queue;
+static size_t tee_queued = 0;
+static uint64_t tee_dropped = 0;  /* lines */
+static bool tee_eof = false;
+static pthread_mutex_t tee_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tee_cond = PTHREAD_COND_INITIALIZER;
+static Fl_Box *tee_status = NULL;
+
+#define TEE_CHUNK (1024*1024)
+#define TEE_QUEUE_MAX (16*1024*1024)
+
 static Fl_Check_Button *checkbutton = NULL;
-static Fl_Return_Button *but_ok;
+static Fl_Return_Button *but_ok = NULL;
 static int ret = 1;
 
 static bool checkbutton_set = false
@@ -68,57 +234,882 @@ static void callback(Fl_Widget *)
   }
 }
 
-static void add_line(const char *line, int line_num) {
-  browser->add(line);
+/* SGR state carried from line to line by the reader thread */
+static text_style ansi_style;
+static std::string ansi_text;
+static std::vector<style_run> ansi_runs;
+
+/* Adds a line, its escape sequences parsed into style runs. Most lines
+ * have none and are added as they are. Lines from STDERR of --command
+ * are red where they don't set a color themselves. */
+static void add_line(const char *text, size_t len, text_style &style = ansi_style, bool is_stderr = false)
+{
+  if (!is_stderr && style.is_default() && !memchr(text, '\033', len)) {
+    store.append(text, len);
+    return;
+  }
+
+  strip_ansi(text, len, ansi_text, ansi_runs, style);
+
+  if (is_stderr) {
+    if (ansi_runs.empty() || ansi_runs[0].offset > 0) {
+      style_run r = { 0, text_style() };
+      ansi_runs.insert(ansi_runs.begin(), r);
+    }
+    for (size_t i = 0; i < ansi_runs.size(); ++i) {
+      if (!(ansi_runs[i].style.attr & STYLE_FG)) {
+        ansi_runs[i].style.fg = 1;
+        ansi_runs[i].style.attr |= STYLE_FG;
+      }
+    }
+  }
+
+  store.append(ansi_text.data(), ansi_text.size(), ansi_runs.data(), ansi_runs.size());
+}
+
+/* called with the lock held after lines were added */
+static void lines_added(void)
+{
+  view->update();
+  search.notify();
+}
 
-  if (autoscroll) {
-    browser->bottomline(line_num);
+/* called with the lock held whenever more lines were searched */
+static void search_cb(void *)
+{
+  char buf[64];
+
+  if (search.needle().empty()) {
+    buf[0] = '\0';
+  } else {
+    snprintf(buf, sizeof(buf), search.busy() ? "%zu+ matches" : "%zu matches", search.count());
   }
+  search_status->copy_label(buf);
+  view->update();
 }
 
-extern "C" void *ti_getline(void *)
+/* starts a new search while typing, Enter jumps to the next match */
+static void search_input_cb(Fl_Widget *o, void *)
 {
-  std::string line;
-  int i = 0;
+  const char *s = dynamic_cast<Fl_Input *>(o)->value();
 
-  while (std::getline(std::cin, line)) {
-    Fl::lock();
-    i++;
-    add_line(line.c_str(), i);
-    Fl::unlock();
-    Fl::awake(win);
+  if (search.needle() == s) {
+    view->next_match();
+  } else {
+    search.start(s);
+    view->search_changed();
+  }
+}
+
+static void filter_cb(Fl_Widget *o, void *)
+{
+  view->filter(dynamic_cast<Fl_Check_Button *>(o)->value());
+}
+
+static void show_search_bar(bool b)
+{
+  int dy = SEARCH_BAR_H + 6;
+
+  if (b == (search_bar->visible() != 0)) {
+    return;
+  }
+
+  if (b) {
+    search_bar->resize(view->x(), view->y(), view->w(), SEARCH_BAR_H);
+    view->resize(view->x(), view->y() + dy, view->w(), view->h() - dy);
+    search_bar->show();
+    search_input->take_focus();
+  } else {
+    search_bar->hide();
+    view->resize(view->x(), view->y() - dy, view->w(), view->h() + dy);
+    view->take_focus();
   }
 
+  /* the hidden bar is ignored when the window is resized */
+  win->init_sizes();
+  win->redraw();
+}
+
+static int search_shortcut(int event)
+{
+  if (event != FL_SHORTCUT) {
+    return 0;
+  }
+
+  if (Fl::event_state(FL_CTRL) && Fl::event_key() == 'f') {
+    show_search_bar(!search_bar->visible());
+    return 1;
+  }
+
+  if (Fl::event_key() == FL_Escape && search_bar->visible()) {
+    show_search_bar(false);
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Adds all complete lines of a chunk to the store at once, so the lock
+ * is taken and the view is updated once per read() instead of per line. */
+static void add_lines(const char *buf, size_t len, std::string &rest,
+                      text_style &style = ansi_style, bool is_stderr = false)
+{
+  const char *end = buf + len;
+
   Fl::lock();
 
+  while (buf < end) {
+    const char *nl = reinterpret_cast<const char *>(memchr(buf, '\n', end - buf));
+
+    if (!nl) {
+      rest.append(buf, end - buf);
+      break;
+    }
+
+    if (rest.empty()) {
+      add_line(buf, nl - buf, style, is_stderr);
+    } else {
+      rest.append(buf, nl - buf);
+      add_line(rest.data(), rest.size(), style, is_stderr);
+      rest.clear();
+    }
+    buf = nl + 1;
+  }
+
+  lines_added();
+  Fl::unlock();
+  Fl::awake(win);
+}
+
+/* called with the lock held once all input was read */
+static void input_finished(void)
+{
   if (autoclose) {
     close_cb(NULL, 0);
   }
 
   if (checkbutton) {
     checkbutton->activate();
-  } else {
+  } else if (but_ok) {
     but_ok->activate();
   }
+}
+
+static bool write_all_cb(const char *data, size_t len, void *v)
+{
+  int fd = *reinterpret_cast<int *>(v);
+
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+extern "C" void *ti_decompress(void *v)
+{
+  decompress_job *job = reinterpret_cast<decompress_job *>(v);
+  decompressor d(job->type);
+  bool ok = d.write(job->head.data(), job->head.size(), write_all_cb, &job->out_fd);
+
+  if (ok && job->data) {
+    ok = d.write(job->data, job->size, write_all_cb, &job->out_fd);
+  }
+
+  if (job->in_fd != -1) {
+    std::vector<char> buf(DECOMPRESS_PIPE_SIZE);
+    ssize_t n;
+
+    while (ok && (n = read(job->in_fd, buf.data(), buf.size())) != 0) {
+      if (n == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      ok = d.write(buf.data(), n, write_all_cb, &job->out_fd);
+    }
+  }
+
+  if (!ok || !d.finish()) {
+    if (!d.error().empty()) {
+      std::cerr << "error: " << d.error() << std::endl;
+    }
+  }
+
+  /* EOF for ti_getline() */
+  close(job->out_fd);
+  delete job;
+
+  return nullptr;
+}
+
+/* Starts decompressing `in_fd', after `head', or the mapped `data';
+ * returns the fd to read the output from, or -1. */
+static int start_decompress(compression type, int in_fd, const char *head, size_t head_len,
+                            const char *data, size_t size)
+{
+  decompress_job *job;
+  pthread_t t;
+  int p[2];
+
+  if (pipe2(p, O_CLOEXEC) == -1) {
+    std::cerr << "error: pipe2(): " << strerror(errno) << std::endl;
+    return -1;
+  }
+  fcntl(p[1], F_SETPIPE_SZ, DECOMPRESS_PIPE_SIZE);
+
+  job = new decompress_job;
+  job->type = type;
+  job->in_fd = in_fd;
+  job->out_fd = p[1];
+  job->head.assign(head, head_len);
+  job->data = data;
+  job->size = size;
+
+  if (pthread_create(&t, 0, &ti_decompress, job) != 0) {
+    std::cerr << "error: pthread_create(): " << strerror(errno) << std::endl;
+    close(p[0]);
+    close(p[1]);
+    delete job;
+    return -1;
+  }
+  pthread_detach(t);
+
+  return p[0];
+}
+
+/* adds the last line, which has no newline, and ends the input */
+static void end_of_input(std::string &rest)
+{
+  Fl::lock();
+
+  if (!rest.empty()) {
+    add_line(rest.data(), rest.size());
+    lines_added();
+  }
+
+  input_finished();
 
   Fl::unlock();
   Fl::awake(win);
+}
+
+/* true as long as the first len bytes could still begin a gzip or zstd
+ * magic, so we don't wait for more input that may come much later */
+static bool may_be_magic(const char *buf, size_t len)
+{
+  const unsigned char gz[] = { 0x1f, 0x8b };
+  const unsigned char zst[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+  return memcmp(buf, gz, std::min(len, sizeof(gz))) == 0 ||
+         memcmp(buf, zst, std::min(len, sizeof(zst))) == 0;
+}
+
+/* reads lines from the fd given as argument, STDIN is checked for
+ * compressed input first */
+extern "C" void *ti_getline(void *v)
+{
+  char buf[64*1024];
+  std::string rest;
+  int fd = static_cast<int>(reinterpret_cast<intptr_t>(v));
+  ssize_t n;
+
+  if (fd == STDIN_FILENO) {
+    size_t have = 0;
+    compression type;
+    int pfd;
+
+    /* enough bytes for the magic, or until it can't be one */
+    while (have < 4 && may_be_magic(buf, have) && (n = read(fd, buf + have, sizeof(buf) - have)) != 0) {
+      if (n == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      have += n;
+    }
+
+    if ((type = detect_compression(buf, have)) != COMPRESSION_NONE &&
+        (pfd = start_decompress(type, fd, buf, have, NULL, 0)) != -1)
+    {
+      fd = pfd;
+    } else if (have > 0) {
+      add_lines(buf, have, rest);
+    }
+  }
+
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    add_lines(buf, n, rest);
+  }
+
+  end_of_input(rest);
+
+  return nullptr;
+}
+
+static size_t count_lines(const char *p, size_t len)
+{
+  const char *end = p + len;
+  size_t n = 0;
+
+  while ((p = reinterpret_cast<const char *>(memchr(p, '\n', end - p))) != NULL) {
+    n++;
+    p++;
+  }
+
+  return n;
+}
+
+static bool is_pipe(int fd)
+{
+  struct stat st;
+  return (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode));
+}
+
+/* Passes STDIN through to STDOUT. Between two pipes tee() duplicates the
+ * data in the kernel and only the copy for the view is read; otherwise
+ * the data is read and written. This thread never waits for the view. */
+extern "C" void *ti_tee(void *)
+{
+  bool use_tee = is_pipe(STDIN_FILENO) && is_pipe(STDOUT_FILENO);
+  bool forward = true, dropped = false, mid_line = false;
+  std::vector<char> chunk(TEE_CHUNK);
+  char *buf = chunk.data();
+  int out = STDOUT_FILENO;
+
+  for (;;) {
+    ssize_t n = 0, got = 0;
+    char *copy;
+
+    if (forward && use_tee) {
+      while ((n = tee(STDIN_FILENO, STDOUT_FILENO, TEE_CHUNK, 0)) == -1 && errno == EINTR) {}
+
+      if (n == -1) {
+        /* EPIPE: nobody reads STDOUT anymore, keep showing the input */
+        forward = false;
+        continue;
+      }
+
+      /* take the duplicated bytes off STDIN */
+      while (got < n) {
+        ssize_t r = read(STDIN_FILENO, buf + got, n - got);
+        if (r == -1 && errno == EINTR) {
+          continue;
+        }
+        if (r <= 0) {
+          break;
+        }
+        got += r;
+      }
+      n = got;
+    } else {
+      while ((n = read(STDIN_FILENO, buf, TEE_CHUNK)) == -1 && errno == EINTR) {}
+
+      if (n > 0 && forward && !write_all_cb(buf, n, &out)) {
+        forward = false;
+      }
+    }
+
+    if (n <= 0) {
+      break;
+    }
+
+    pthread_mutex_lock(&tee_mutex);
+
+    if (tee_queued + n > TEE_QUEUE_MAX || (copy = reinterpret_cast<char *>(malloc(n))) == NULL) {
+      tee_dropped += count_lines(buf, n);
+      dropped = true;
+      mid_line = (buf[n - 1] != '\n');
+    } else {
+      tee_chunk c = { copy, static_cast<size_t>(n), dropped, mid_line };
+      memcpy(copy, buf, n);
+      tee_queue.push_back(c);
+      tee_queued += n;
+      dropped = mid_line = false;
+      pthread_cond_signal(&tee_cond);
+    }
+
+    pthread_mutex_unlock(&tee_mutex);
+  }
+
+  pthread_mutex_lock(&tee_mutex);
+  tee_eof = true;
+  pthread_cond_signal(&tee_cond);
+  pthread_mutex_unlock(&tee_mutex);
 
   return nullptr;
 }
 
-int dialog_textinfo(bool autoscroll_, const char *checkbox, bool autoclose_, bool hide_cancel_)
+/* adds the chunks of ti_tee() to the view */
+extern "C" void *ti_tee_display(void *)
 {
+  std::string rest;
+  uint64_t shown = 0, skipped = 0;
+  bool skipping = false;
+
+  for (;;) {
+    tee_chunk c;
+    uint64_t dropped;
+    const char *p;
+    size_t len;
+
+    pthread_mutex_lock(&tee_mutex);
+    while (tee_queue.empty() && !tee_eof) {
+      pthread_cond_wait(&tee_cond, &tee_mutex);
+    }
+    if (tee_queue.empty()) {
+      pthread_mutex_unlock(&tee_mutex);
+      break;
+    }
+    c = tee_queue.front();
+    tee_queue.pop_front();
+    tee_queued -= c.len;
+    dropped = tee_dropped;
+    pthread_mutex_unlock(&tee_mutex);
+
+    p = c.data;
+    len = c.len;
+
+    /* The line in front of the gap ended in the dropped data, where it
+     * was counted. A line that started there and ends here is skipped
+     * and counted here. */
+    if (c.dropped_before) {
+      rest.clear();
+      skipping = c.mid_line;
+    }
+    if (skipping) {
+      const char *nl = reinterpret_cast<const char *>(memchr(p, '\n', len));
+      if (nl) {
+        len -= nl + 1 - p;
+        p = nl + 1;
+        skipped++;
+        skipping = false;
+      } else {
+        len = 0;
+      }
+    }
+
+    if (len > 0) {
+      add_lines(p, len, rest);
+    }
+    free(c.data);
+
+    if (tee_status && dropped + skipped != shown) {
+      char label[64];
+
+      shown = dropped + skipped;
+      snprintf(label, sizeof(label), "%llu lines dropped", static_cast<unsigned long long>(shown));
+
+      Fl::lock();
+      tee_status->copy_label(label);
+      Fl::unlock();
+      Fl::awake(win);
+    }
+  }
+
+  end_of_input(rest);
+
+  return nullptr;
+}
+
+/* Builds the line index of a mapped file in steps; the scrollbar range
+ * grows with every step while the first lines can be viewed already.
+ * Each step is scanned by all cores in parallel. */
+extern "C" void *ti_index(void *)
+{
+  std::vector<uint64_t> starts;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = (cores > 1) ? cores : 1;
+  size_t step = INDEX_FIRST_BLOCK, count;
+  uint64_t end;
+
+  starts.push_back(0);
+
+  for (size_t pos = 0; pos < map_size; pos += step, step = INDEX_BLOCK * threads) {
+    size_t to = (map_size - pos > step) ? pos + step : map_size;
+
+    find_line_starts_parallel(map, pos, to, threads, starts);
+
+    if (to == map_size) {
+      /* no empty line after a final newline */
+      if (starts.back() == map_size) {
+        starts.pop_back();
+      }
+      count = starts.size();
+      end = map_size;
+    } else {
+      /* the last line may go on in the next step; it is added once its
+       * end is known, so the store never holds unindexed text */
+      count = starts.size() - 1;
+      end = starts.back();
+    }
+
+    Fl::lock();
+    store.append_mapped(map, starts.data(), count, end);
+    lines_added();
+    Fl::unlock();
+    Fl::awake(win);
+
+    starts.erase(starts.begin(), starts.begin() + count);
+  }
+
+  Fl::lock();
+  input_finished();
+  Fl::unlock();
+  Fl::awake(win);
+
+  return nullptr;
+}
+
+static bool map_file(const char *filename)
+{
+  struct stat st;
+  void *p;
+  int fd;
+
+  if ((fd = open(filename, O_RDONLY|O_CLOEXEC)) == -1 || fstat(fd, &st) == -1) {
+    std::cerr << "error: " << filename << ": " << strerror(errno) << std::endl;
+    if (fd != -1) {
+      close(fd);
+    }
+    return false;
+  }
+
+  map_size = st.st_size;
+
+  /* mmap() fails on empty files */
+  if (map_size > 0) {
+    if ((p = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+      std::cerr << "error: " << filename << ": " << strerror(errno) << std::endl;
+      close(fd);
+      return false;
+    }
+    map = reinterpret_cast<const char *>(p);
+  }
+
+  close(fd);
+  return true;
+}
+
+/* Reads the next chunk of the followed file from the last offset and
+ * schedules itself again until the end is reached. */
+static void follow_read(void *)
+{
+  struct stat st;
+  ssize_t n;
+
+  follow_pending = false;
+
+  if (follow_fd == -1) {
+    return;
+  }
+
+  /* truncated in place, e.g. by logrotate's copytruncate */
+  if (fstat(follow_fd, &st) == 0 && st.st_size < follow_offset) {
+    lseek(follow_fd, 0, SEEK_SET);
+    follow_offset = 0;
+    follow_rest.clear();
+  }
+
+  while ((n = read(follow_fd, follow_buf.data(), follow_buf.size())) == -1 && errno == EINTR) {}
+
+  if (n > 0) {
+    follow_offset += n;
+    add_lines(follow_buf.data(), n, follow_rest);
+  }
+
+  if (n == static_cast<ssize_t>(follow_buf.size())) {
+    follow_pending = true;
+    Fl::add_timeout(0.0, follow_read);
+  } else if (!follow_started) {
+    /* all there was at the start was read */
+    follow_started = true;
+    input_finished();
+  }
+}
+
+static void follow_schedule(void)
+{
+  if (!follow_pending) {
+    follow_pending = true;
+    Fl::add_timeout(0.0, follow_read);
+  }
+}
+
+static bool follow_open(void)
+{
+  struct stat st;
+  int fd = open(follow_path.c_str(), O_RDONLY|O_CLOEXEC);
+
+  if (fd == -1 || fstat(fd, &st) == -1) {
+    if (fd != -1) {
+      close(fd);
+    }
+    return false;
+  }
+
+  follow_fd = fd;
+  follow_ino = st.st_ino;
+  follow_offset = 0;
+  follow_wd = inotify_add_watch(inotify_fd, follow_path.c_str(), IN_MODIFY|IN_MOVE_SELF|IN_DELETE_SELF);
+
+  return true;
+}
+
+/* The file was moved or deleted, or a file of its name was created:
+ * reads what is left of the old file and switches to the new one. */
+static void follow_reopen(void)
+{
+  struct stat st;
+  ssize_t n;
+
+  if (follow_fd != -1) {
+    if (stat(follow_path.c_str(), &st) == 0 && st.st_ino == follow_ino) {
+      follow_schedule();
+      return;
+    }
+
+    while ((n = read(follow_fd, follow_buf.data(), follow_buf.size())) > 0 || (n == -1 && errno == EINTR)) {
+      if (n > 0) {
+        add_lines(follow_buf.data(), n, follow_rest);
+      }
+    }
+
+    /* last line of the old file without newline */
+    if (!follow_rest.empty()) {
+      add_lines("\n", 1, follow_rest);
+    }
+
+    if (follow_wd != -1) {
+      inotify_rm_watch(inotify_fd, follow_wd);
+      follow_wd = -1;
+    }
+    close(follow_fd);
+    follow_fd = -1;
+  }
+
+  /* if the new file doesn't exist yet, the directory watch tells when */
+  if (follow_open()) {
+    follow_schedule();
+  }
+}
+
+static void inotify_cb(int fd, void *)
+{
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  bool modified = false, reopen = false;
+  ssize_t n;
+
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    const struct inotify_event *ev;
+
+    for (char *p = buf; p < buf + n; p += sizeof(struct inotify_event) + ev->len) {
+      ev = reinterpret_cast<const struct inotify_event *>(p);
+
+      if (ev->wd == follow_wd && follow_wd != -1) {
+        if (ev->mask & IN_MODIFY) {
+          modified = true;
+        }
+        if (ev->mask & (IN_MOVE_SELF|IN_DELETE_SELF)) {
+          reopen = true;
+        }
+      } else if (ev->wd == dir_wd && ev->len > 0 && follow_name == ev->name) {
+        reopen = true;
+      }
+    }
+  }
+
+  if (reopen) {
+    follow_reopen();
+  } else if (modified) {
+    follow_schedule();
+  }
+}
+
+static bool follow_file(const char *filename)
+{
+  std::string dir;
+  size_t slash;
+
+  follow_path = filename;
+  slash = follow_path.rfind('/');
+  dir = (slash == std::string::npos) ? "." : (slash == 0) ? "/" : follow_path.substr(0, slash);
+  follow_name = (slash == std::string::npos) ? follow_path : follow_path.substr(slash + 1);
+
+  if ((inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC)) == -1) {
+    std::cerr << "error: inotify_init1(): " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  if (!follow_open()) {
+    std::cerr << "error: " << filename << ": " << strerror(errno) << std::endl;
+    close(inotify_fd);
+    return false;
+  }
+
+  /* a rotated file is replaced by a new one of the same name */
+  dir_wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_CREATE|IN_MOVED_TO);
+
+  follow_buf.resize(FOLLOW_CHUNK);
+  return true;
+}
+
+static void cmd_wait(void *)
+{
+  int status;
+  pid_t rv;
+
+  while ((rv = waitpid(cmd_pid, &status, WNOHANG)) == -1 && errno == EINTR) {}
+
+  if (rv == 0) {
+    Fl::add_timeout(CMD_POLL_INTERVAL, cmd_wait);
+    return;
+  }
+
+  if (rv == cmd_pid) {
+    cmd_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  }
+  cmd_pid = -1;
+
+  input_finished();
+}
+
+static void cmd_read_cb(int fd, void *v)
+{
+  cmd_stream *s = reinterpret_cast<cmd_stream *>(v);
+  char buf[64*1024];
+  size_t total = 0;
+  ssize_t n = 1;
+
+  while (total < CMD_READ_MAX && (n = read(fd, buf, sizeof(buf))) > 0) {
+    add_lines(buf, n, s->rest, s->style, s->is_stderr);
+    total += n;
+  }
+
+  if (n > 0 || (n == -1 && (errno == EAGAIN || errno == EINTR))) {
+    return;
+  }
+
+  /* EOF */
+  Fl::remove_fd(fd);
+  close(fd);
+  s->fd = -1;
+
+  if (!s->rest.empty()) {
+    add_line(s->rest.data(), s->rest.size(), s->style, s->is_stderr);
+    s->rest.clear();
+    lines_added();
+  }
+
+  if (cmd_out.fd == -1 && cmd_err.fd == -1) {
+    cmd_wait(NULL);
+  }
+}
+
+/* Runs `command' without a shell; the command line is split into words
+ * by wordexp(), which handles quotes and variables but no pipes or
+ * redirections. */
+static bool cmd_start(const char *command)
+{
+  posix_spawn_file_actions_t fa;
+  wordexp_t we;
+  int out[2], err[2], rv;
+
+  if ((rv = wordexp(command, &we, WRDE_NOCMD)) != 0 || we.we_wordc == 0) {
+    if (rv == 0) {
+      wordfree(&we);
+    }
+    std::cerr << "error: --command: " << ((rv == WRDE_BADCHAR || rv == WRDE_CMDSUB)
+      ? "shell syntax isn't supported, use sh -c '...'" : "cannot parse the command line") << std::endl;
+    return false;
+  }
+
+  if (pipe2(out, O_CLOEXEC) == -1) {
+    std::cerr << "error: pipe2(): " << strerror(errno) << std::endl;
+    wordfree(&we);
+    return false;
+  }
+  if (pipe2(err, O_CLOEXEC) == -1) {
+    std::cerr << "error: pipe2(): " << strerror(errno) << std::endl;
+    close(out[0]);
+    close(out[1]);
+    wordfree(&we);
+    return false;
+  }
+
+  posix_spawn_file_actions_init(&fa);
+  posix_spawn_file_actions_adddup2(&fa, out[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2(&fa, err[1], STDERR_FILENO);
+  rv = posix_spawnp(&cmd_pid, we.we_wordv[0], &fa, NULL, we.we_wordv, environ);
+  posix_spawn_file_actions_destroy(&fa);
+
+  close(out[1]);
+  close(err[1]);
+
+  if (rv != 0) {
+    std::cerr << "error: " << we.we_wordv[0] << ": " << strerror(rv) << std::endl;
+    wordfree(&we);
+    close(out[0]);
+    close(err[0]);
+    cmd_pid = -1;
+    return false;
+  }
+  wordfree(&we);
+
+  fcntl(out[0], F_SETFL, fcntl(out[0], F_GETFL) | O_NONBLOCK);
+  fcntl(err[0], F_SETFL, fcntl(err[0], F_GETFL) | O_NONBLOCK);
+  cmd_out.fd = out[0];
+  cmd_err.fd = err[0];
+
+  return true;
+}
+
+int dialog_textinfo(const textinfo_options &opt)
+{
+  const char *checkbox = opt.checkbox;
   Fl_Group *g;
   Fl_Box *dummy;
   Fl_Button *but_cancel;
-  int browser_h = checkbox ? 422 : 444;
+  int view_h = checkbox ? 422 : 444;
   int but_w = 90, win_ret = 0;
-  pthread_t t;
+  compression type;
+  int fd;
+  pthread_t t, tee_thread;
+
+  autoscroll = opt.autoscroll;
+  autoclose = opt.autoclose;
+  hide_cancel = opt.hide_cancel;
+
+  if (opt.filename && !map_file(opt.filename)) {
+    return 1;
+  }
 
-  autoscroll = autoscroll_;
-  autoclose = autoclose_;
-  hide_cancel = hide_cancel_;
+  if (opt.follow && !follow_file(opt.follow)) {
+    return 1;
+  }
+
+  if (opt.command && !cmd_start(opt.command)) {
+    return 1;
+  }
+
+  store.limit(opt.max_lines, opt.max_bytes);
 
   if (!title) {
     title = "FLTK text info window";
@@ -126,18 +1117,39 @@ int dialog_textinfo(bool autoscroll_, const char *checkbox, bool autoclose_, boo
 
   win = new Fl_Double_Window(400, 500, title);
   {
-    browser = new Fl_Multi_Browser(10, 10, 380, browser_h);
+    view = new text_view(10, 10, 380, view_h, &store);
+    view->autoscroll(autoscroll);
+    view->search(&search);
+    search.callback(search_cb, NULL);
+
+    search_bar = new Fl_Group(10, 10, 380, SEARCH_BAR_H);
+    {
+      Fl_Check_Button *filter;
+
+      search_input = new Fl_Input(10, 10, 200, SEARCH_BAR_H);
+      search_input->when(FL_WHEN_CHANGED | FL_WHEN_ENTER_KEY_ALWAYS);
+      search_input->callback(search_input_cb);
+
+      filter = new Fl_Check_Button(215, 10, 70, SEARCH_BAR_H, " Filter");
+      filter->callback(filter_cb);
+
+      search_status = new Fl_Box(290, 10, 100, SEARCH_BAR_H);
+      search_status->align(FL_ALIGN_RIGHT|FL_ALIGN_INSIDE);
+    }
+    search_bar->resizable(search_input);
+    search_bar->end();
+    search_bar->hide();
 
     if (checkbox || !autoclose || !hide_cancel) {
       win_ret = 1;
 
-      g = new Fl_Group(0, browser_h, 400, 500);
+      g = new Fl_Group(0, view_h, 400, 500);
       {
         int but_x = win->w();
 
         if (checkbox) {
           std::string s = std::string{" "} + checkbox;
-          checkbutton = new Fl_Check_Button(10, browser_h + 12, 380, 26);
+          checkbutton = new Fl_Check_Button(10, view_h + 12, 380, 26);
           checkbutton->callback(callback);
           checkbutton->copy_label(s.c_str());
           checkbutton->deactivate();
@@ -160,14 +1172,25 @@ int dialog_textinfo(bool autoscroll_, const char *checkbox, bool autoclose_, boo
           but_x = but_ok->x() - 1;
         }
 
-        dummy = new Fl_Box(but_x, browser_h + 10, 1, 1);
+        if (opt.tee) {
+          tee_status = new Fl_Box(10, win->h() - 36, but_x - 20, 26);
+          tee_status->align(FL_ALIGN_LEFT|FL_ALIGN_INSIDE);
+        }
+
+        dummy = new Fl_Box(but_x, view_h + 10, 1, 1);
         dummy->box(FL_NO_BOX);
       }
       g->resizable(dummy);
       g->end();
     }
+
+    /* without buttons the counter gets the row to itself */
+    if (opt.tee && !tee_status) {
+      tee_status = new Fl_Box(10, win->h() - 36, 380, 26);
+      tee_status->align(FL_ALIGN_LEFT|FL_ALIGN_INSIDE);
+    }
   }
-  set_size(win, browser);
+  set_size(win, view);
   set_size_range(win, but_w + 40, checkbox ? 120 : 90);
   set_position(win);
   win->end();
@@ -180,10 +1203,53 @@ int dialog_textinfo(bool autoscroll_, const char *checkbox, bool autoclose_, boo
   set_undecorated(win);
   set_always_on_top(win);
 
-  pthread_create(&t, 0, &ti_getline, NULL);
+  Fl::add_handler(search_shortcut);
+
+  if (opt.command) {
+    Fl::add_fd(cmd_out.fd, FL_READ, cmd_read_cb, &cmd_out);
+    Fl::add_fd(cmd_err.fd, FL_READ, cmd_read_cb, &cmd_err);
+  } else if (opt.tee) {
+    /* a closed STDOUT shows up as EPIPE */
+    signal(SIGPIPE, SIG_IGN);
+    pthread_create(&tee_thread, 0, &ti_tee, NULL);
+    pthread_create(&t, 0, &ti_tee_display, NULL);
+  } else if (opt.follow) {
+    Fl::add_fd(inotify_fd, FL_READ, inotify_cb);
+    follow_schedule();
+  } else if (!opt.filename) {
+    pthread_create(&t, 0, &ti_getline, reinterpret_cast<void *>(static_cast<intptr_t>(STDIN_FILENO)));
+  } else if (map && (type = detect_compression(map, map_size)) != COMPRESSION_NONE) {
+    /* compressed files can't be indexed in place */
+    madvise(const_cast<char *>(map), map_size, MADV_SEQUENTIAL);
+    if ((fd = start_decompress(type, -1, NULL, 0, map, map_size)) != -1) {
+      pthread_create(&t, 0, &ti_getline, reinterpret_cast<void *>(static_cast<intptr_t>(fd)));
+    } else {
+      input_finished();
+    }
+  } else if (map) {
+    pthread_create(&t, 0, &ti_index, NULL);
+  } else {
+    input_finished();
+  }
 
   Fl::run();
 
+  /* The window is gone, but the rest of the pipeline still gets all of
+   * the input. The lock stays held, so the display thread stops and the
+   * remaining chunks are dropped instead of shown. */
+  if (opt.tee) {
+    pthread_join(tee_thread, NULL);
+  }
+
+  if (opt.command) {
+    if (cmd_pid != -1) {
+      /* closed before the command finished */
+      kill(cmd_pid, SIGTERM);
+    } else if (ret == 0 && cmd_status != -1) {
+      ret = cmd_status;
+    }
+  }
+
   return ret;
 }
 